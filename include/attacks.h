@@ -7,5 +7,10 @@
 #define NOT_ATTACKED 	0
 
 int attacks(int ctm,square_t sq);
+int attackers(int ctm,square_t sq,square_t *from);
+int between(square_t a,square_t b,square_t sq);
+int maybe_check(const move_t *m,square_t ksq);
 int see(int attacking_color,move_t * m);
+int see_ge(int attacking_color,move_t * m,int threshold);
+int capture_gain(const move_t * m);
 #endif /* __ATTACKS_H */
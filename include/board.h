@@ -29,10 +29,10 @@ typedef unsigned char square_t;
 /* the chess board is 16x8 squares. it contains pointers to
 the piecelist */
 
-extern  plistentry_t * BOARD[];
+extern THREAD_LOCAL plistentry_t * BOARD[];
 
-extern unsigned turn;
-extern unsigned current_ply;
+extern THREAD_LOCAL unsigned turn;
+extern THREAD_LOCAL unsigned current_ply;
 extern unsigned computer_color;
 
 #endif /* __BOARD_H */
@@ -3,6 +3,19 @@
 #ifndef __CHESS_H
 #define __CHESS_H
 
+/* 
+ * Storage class for the search state every search thread keeps for
+ * itself (board, piece list, move stack, killers...). Helper threads
+ * of the parallel search get their own copy, see smp.c.
+ */
+#if defined (__GNUC__)
+#define THREAD_LOCAL __thread
+#elif defined (_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL
+#endif
+
 #include "board.h"
 
 #ifndef NULL
@@ -71,19 +84,21 @@ typedef struct move_tag {
   int special; 
   /* low byte: captured piece; 2nd byte: promoted to; byte 3,4 unused */ 
   int cap_pro;
-  int key;
 } move_t;
 
 
 #define MAX_MOVE_ARRAY 	1800
 #define MOVE_ARRAY_SAFETY_THRESHOLD 50
-extern move_t move_array[];
+extern THREAD_LOCAL move_t move_array[];
+/* ordering keys of move_array, kept apart so that pick() scans only
+   the keys */
+extern THREAD_LOCAL int move_key[];
 
 #define MAX_SEARCH_DEPTH 70
-extern move_t * current_line[];
+extern THREAD_LOCAL move_t * current_line[];
 
 typedef move_t line_t[MAX_SEARCH_DEPTH];
-extern line_t principal_variation[];
+extern THREAD_LOCAL line_t principal_variation[];
 
 typedef struct position_hash_tag {
   unsigned int part_one;
@@ -129,7 +144,7 @@ typedef struct move_flag_tag {
   position_hash_t phash;                /* pawn hash value */
   plistentry_t *just_deleted_entry;	/* undo info for captures */
   plistentry_t *last_promoted;
-  int           extension_count;        /* restrict extensions - not used! */
+  int           extension_count;        /* extended so far, see search.h */
   square_t	white_king_square;
   square_t	black_king_square;
   square_t	e_p_square;
@@ -138,7 +153,7 @@ typedef struct move_flag_tag {
 #define FLAGS_INIT (-1)
 
 #define MAX_MOVE_FLAGS	300
-extern move_flag_t move_flags[];
+extern THREAD_LOCAL move_flag_t move_flags[];
 
 typedef struct game_history_tag {
   move_t m;
@@ -182,9 +197,28 @@ struct gamestat_tag {
   char testpos_avoid[TESTPOS_SOL_LENGTH];
   unsigned p_hash_hits;
   unsigned p_hash_misses;
+  unsigned long pvs_re_searches; /* null window failed high */
+  unsigned long lmr_reductions; /* late moves searched with less depth */
+  unsigned long lmr_re_searches; /* ... and searched again */
+  unsigned long futility_prunes; /* quiet moves skipped, eval far below */
+  unsigned long razor_cutoffs; /* nodes cut by quies() near the leaves */
+  unsigned long lmp_prunes; /* late quiet moves skipped near the leaves */
+  unsigned long iid_searches; /* reduced searches for a missing hash move */
+  unsigned long quies_evasions; /* quies nodes in check */
+  unsigned long quies_checks; /* quiet checks searched in quies */
+  unsigned long singular_searches; /* exclusion searches for the hash move */
+  unsigned long singular_extensions; /* ... which found it singular */
+  unsigned long etc_cutoffs; /* nodes cut by a child's table entry */
+  unsigned long probcut_cutoffs; /* nodes cut by a shallow capture search */
+  unsigned long null_cutoffs; /* nodes cut by a null move */
+  unsigned long null_verifications; /* null move fail highs verified */
+  unsigned long tt_probes; /* transref lookups in search */
+  unsigned long tt_hits;
+  unsigned long tt_quies_probes; /* ... and in quies */
+  unsigned long tt_quies_hits;
 };
 
-extern struct gamestat_tag gamestat;
+extern THREAD_LOCAL struct gamestat_tag gamestat;
 
 /**************** TEST RELATED DEFINITIONS ***********************/
 
@@ -204,6 +238,7 @@ extern struct test_stats_tag test_stat;
 #define CMD_TEST_MAKE 5 /* generate, do, undo */
 #define CMD_TEST_EVAL 6 /* perform static analysis only */
 #define CMD_TEST_BENCH 7 /* coarse set of built-in test runs */
+#define CMD_TEST_CHECK 8 /* deterministic self check, no test file */
 
 #define CMD_TEST_DEFAULT CMD_TEST_SOLVE
 
@@ -220,6 +255,12 @@ extern struct test_stats_tag test_stat;
 #define O_NULL_BIT 128 /* if 0, never use null move */
 #define O_BOOK_BIT 256 /* if 0, do not use book*/
 #define O_FRITZ_BIT 512 /* chessbase interpretation of wb protocol */
+#define O_EMBEDDED_BIT 1024 /* library use: no stdin, no stdout, see gully.c */
+#define O_PVS_BIT 2048 /* principal variation search */
+#define O_FUTILITY_BIT 4096 /* futility pruning near the leaves */
+#define O_RAZOR_BIT 8192 /* razoring into quies() */
+#define O_LMP_BIT 16384 /* late move (move count) pruning */
+#define O_QCHECKS_BIT 32768 /* quiet checks in quies, see quies.h */
 
 /* useful macros for runtime option testing */
 #define TRANSREF_ON (gameopt.options & O_TRANSREF_BIT)
@@ -232,6 +273,12 @@ extern struct test_stats_tag test_stat;
 #define NULL_ON (gameopt.options & O_NULL_BIT)
 #define BOOK_ON (gameopt.options & O_BOOK_BIT)
 #define FRITZ_ON (gameopt.options & O_FRITZ_BIT)
+#define EMBEDDED_ON (gameopt.options & O_EMBEDDED_BIT)
+#define PVS_ON (gameopt.options & O_PVS_BIT)
+#define FUTILITY_ON (gameopt.options & O_FUTILITY_BIT)
+#define RAZOR_ON (gameopt.options & O_RAZOR_BIT)
+#define LMP_ON (gameopt.options & O_LMP_BIT)
+#define QCHECKS_ON (gameopt.options & O_QCHECKS_BIT)
 
 #define PRINT_EVAL_ON (gameopt.test == CMD_TEST_EVAL)
 
@@ -242,17 +289,33 @@ else gameopt.options |= (o_bit)
 #define SET_OPTION(o_bit) gameopt.options |= (o_bit)
 #define RESET_OPTION(o_bit) gameopt.options &= ~(o_bit)
 
+#define MAX_SEARCHMOVES 64
+
 /* see reset_gameoptions for init! */
 struct gameoptions_tag {
   int maxdepth;
+  unsigned long maxnodes; /* 0 == no limit */
   int options; /* see O_*_BIT flags above */
-  int transref_size;
+  int transref_size; /* MB, 0 == no table */
   int test;
+  int threads; /* search threads, see smp.c */
+  int lmr_moves; /* late move reductions after so many moves, 0 == off */
+  int lmr_depth; /* ... if at least so many plies remain */
+  int iid_depth; /* internal iterative deepening from this depth, 0 == off */
+  int singular_depth; /* singular extensions from this depth, 0 == off */
+  int ext_check; /* extensions in 1/EXTENSION_ONE_PLY plies: in check, */
+  int ext_recapture; /* ... recaptures, */
+  int ext_pawn; /* ... pawn pushes to the 7th rank */
+  int ext_single; /* ... and single replies to check, added to ext_check */
+  int probcut_margin; /* ProbCut above beta by so much, 0 == off */
+  int probcut_reduction; /* ... with the depth reduced by so many plies */
+  int searchmoves[MAX_SEARCHMOVES + 1]; /* root moves (from_to) to search,
+					   0 terminated, empty == all */
   char testfile[1024]; /* linux PATH_MAX hardcoded... */
   /* see top for possible values of test */
 };
 
-extern struct gameoptions_tag gameopt;
+extern THREAD_LOCAL struct gameoptions_tag gameopt;
 
 
 /* book related types */
@@ -261,7 +324,12 @@ typedef struct book_position_tag {
   position_hash_t status;
 } book_position_t;
 
-extern int abort_search;
+/* 
+ * Raised to stop the search. All threads searching for the same 
+ * engine share the flag, see engine.c.
+ */
+extern THREAD_LOCAL volatile int * abort_flag;
+#define abort_search (*abort_flag)
 
 /* special globals */
 extern move_t user_move, ponder_move;
@@ -269,7 +337,7 @@ extern int saved_command;
 
 enum global_search_state_tag { IDLING, SEARCHING, PONDERING, ANALYZING };
 
-extern enum global_search_state_tag global_search_state;
+extern THREAD_LOCAL enum global_search_state_tag global_search_state;
 
 #define IS_PONDERING (global_search_state == PONDERING)
 #define IS_SEARCHING (global_search_state == SEARCHING)
@@ -277,7 +345,7 @@ extern enum global_search_state_tag global_search_state;
 #define IS_IDLE (global_search_state == IDLING)
 
 enum game_phase_tag { BOOK, OPENING, MIDDLEGAME, ENDGAME, PAWNLESS};
-extern enum game_phase_tag game_phase;
+extern THREAD_LOCAL enum game_phase_tag game_phase;
 
 
 #endif /* chess.h */
@@ -39,6 +39,18 @@ void fprint_move_flags(FILE *, move_flag_t *);
 
 void fprint_pv(FILE * where);
 
+/* 
+   reads moves like "e2e4,g8f6" or "e7e8q b1c3" into from_to values,
+   returns their number or -1 on a parse error
+   */
+int parse_coordinate_moves(const char *s, int *moves, int max);
+
+/* root moves with their subtree sizes and scores, at most max */
+void fprint_root_moves(FILE * where, int max);
+
+/* search counters after a search of time seconds */
+void fprint_gamestats(FILE * where, double time);
+
 void fpost(FILE * where, int full_depth, int what, int score, float time);
 
 int fprint_game(FILE * where, struct the_game_tag * g);
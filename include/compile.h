@@ -5,9 +5,7 @@
 #ifndef __COMPILE_H
 #define __COMPILE_H
 
-#if 0
-#define QUIES_CHECK /* test for being in check during quies */
-#endif
+#define QUIES_CHECK /* evasions in check, quiet checks in quies */
 
 #if 0
 #define HUNG_PIECE_DETECT /* hung piece detection */
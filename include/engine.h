@@ -0,0 +1,55 @@
+/* $Id$ */
+
+#ifndef __ENGINE_H
+#define __ENGINE_H
+
+#include "chess.h"
+#include "plist.h"
+#include "mstimer.h"
+#include "transref.h"
+#include "repeat.h"
+
+/* 
+ * Everything an engine keeps between two searches. The search itself
+ * works on the thread local globals (BOARD, PList, move_flags, gameopt,
+ * ...); engine_load() sets them up from an engine context on the
+ * calling thread, engine_save() stores them back. 
+ *
+ * Used for the helper threads of the parallel search (smp.c) and
+ * for the independent engines of the library interface (gully.c).
+ */
+struct engine_tag {
+  /* root position */
+  plistentry_t plist[PLIST_MAXENTRIES];
+  int board[128]; /* offsets into plist, -1 for empty squares */
+  int max_white_piece, max_white_pawn, max_black_piece, max_black_pawn;
+  move_flag_t flags;
+  int just_deleted, last_promoted; /* plist offsets of the root flags */
+  unsigned turn;
+  int max_pos_score;
+  struct rep_snapshot_tag rep;
+
+  /* settings and limits */
+  enum game_phase_tag phase; /* see phase() */
+  struct gameoptions_tag opt;
+  struct game_time_tag time;
+
+  /* tables and stop flag, not owned by the context */
+  tt_bucket_t * ttable;
+  unsigned long tt_buckets;
+  unsigned int tt_generation;
+  ph_entry_t * ptable;
+  volatile int * abort_flag;
+
+  /* outcome of the last search */
+  struct gamestat_tag stat;
+  line_t pv;
+};
+
+/* store the state of the calling thread to e */
+void engine_save(struct engine_tag *e);
+
+/* set up the state of the calling thread from e */
+void engine_load(const struct engine_tag *e);
+
+#endif /* engine.h */
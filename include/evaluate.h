@@ -43,7 +43,7 @@
 #define ROOK_7TH_RANK 10
 #define ROOKPAIR_7TH_RANK 50
 
-extern int max_pos_score;
+extern THREAD_LOCAL int max_pos_score;
 
 /* returns the current material_score (based on the plist) 
    Normally, material is incrementally updated, that's for init
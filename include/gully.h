@@ -0,0 +1,79 @@
+/* $Id$ */
+
+#ifndef __GULLY_H
+#define __GULLY_H
+
+/* 
+ * Library interface (libgully.a, see src/Makefile). 
+ *
+ * Any number of engines may be created. Every engine has its own
+ * position, hash tables and options. An engine must only be used by
+ * one thread at a time; different engines may search in parallel.
+ *
+ * The search does not take an engine as an explicit argument. It
+ * works on thread local globals, and every call copies the engine
+ * into those of the calling thread and back (engine_load() and
+ * engine_save(), see engine.h). A call therefore costs a copy of the
+ * position, and killers and history are not kept from one search to
+ * the next. Everything else an engine needs, helper threads' pawn
+ * tables included, stays with the engine and is freed by
+ * gully_delete(), whichever threads have used it.
+ *
+ * Scores are in centipawns from the side to move's point of view.
+ * src/gullytest.c is an example with two engines searching side by
+ * side.
+ */
+
+typedef struct gully_tag gully_t;
+
+/* once per process, before anything else. Returns 0 on failure. */
+int gully_init(void);
+
+/* 
+ * New engine on the start position with a main hash table of 
+ * hash_mb megabytes (0: default size). NULL on failure. The engine
+ * is set up on a thread of its own, the search state of the calling
+ * thread is not touched.
+ */
+gully_t * gully_new(int hash_mb);
+void gully_delete(gully_t *g);
+
+/* returns 0 if fen cannot be parsed; the position is unchanged then */
+int gully_set_fen(gully_t *g, const char *fen);
+
+/* search threads for the following searches (1 .. 64) */
+void gully_set_threads(gully_t *g, int threads);
+
+/* 
+ * Restricts the following searches to the given root moves in
+ * coordinate notation ("e2e4 g1f3"), NULL or "" for all moves.
+ * Returns 0 if the moves cannot be parsed.
+ */
+int gully_set_searchmoves(gully_t *g, const char *moves);
+
+/* forget everything learned in the hash tables */
+void gully_clear_hash(gully_t *g);
+
+/* 
+ * Searches the current position. The search stops at whichever limit 
+ * is reached first: depth (plies), nodes or time (milliseconds). 
+ * 0 means no limit; at least one limit must be given.
+ * Returns the score.
+ */
+int gully_search(gully_t *g, int depth, unsigned long nodes, long msecs);
+
+/* results of the last search */
+int gully_score(const gully_t *g);
+unsigned long gully_nodes(const gully_t *g);
+
+/* permille of the hash table written by the last search */
+int gully_hashfull(gully_t *g);
+
+/* 
+ * Principal variation in coordinate notation ("e2e4 e7e5 g1f3"),
+ * at most len bytes including the terminating 0. Returns the number
+ * of moves.
+ */
+int gully_pv(const gully_t *g, char *buf, int len);
+
+#endif /* gully.h */
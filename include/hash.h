@@ -46,6 +46,9 @@
      
 unsigned int random32(void);
 void init_hash(void);
+
+/* identifies the keys of init_hash(), see tt_save() */
+unsigned int hash_keys_fingerprint(void);
 int generate_hash_value(position_hash_t *);
 
 /* 
@@ -72,6 +75,18 @@ void update_hash_prom(position_hash_t * h, const move_t * m);
 /* null move */
 void hash_change_turn(position_hash_t *);
 
+/* 
+   key after a normal move at ply without making it, returns 0 for
+   special moves, promotions and changes of the castling rights
+   */
+int child_hash(position_hash_t * h, const move_t * m, int ply);
+
+/* 
+   pawn key after a normal move or double advance at ply, returns 0
+   if the pawn key does not change or for the other special moves
+   */
+int child_pawn_hash(position_hash_t * h, const move_t * m, int ply);
+
 /* init pawn hashing */
 int generate_pawn_hash_value(position_hash_t * h);
 
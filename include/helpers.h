@@ -20,4 +20,12 @@ void prompt(void);
 /* Close logfile and do whatever housekeeping is neccessary */
 void quit(void);
 int command_help(int cmd);
+
+/* re-entrant strtok(): library engines set up positions in parallel */
+#if defined (_MSC_VER)
+#define STRTOK_R(s,delim,save) strtok_s((s),(delim),(save))
+#else
+#define STRTOK_R(s,delim,save) strtok_r((s),(delim),(save))
+#endif
+
 #endif /* helpers.h */
@@ -11,11 +11,34 @@ struct killer_struct_tag {
   int use_count;
 };
 
-extern struct killer_struct_tag Killer[MAX_KILLER_PLY][2];
+extern THREAD_LOCAL struct killer_struct_tag Killer[MAX_KILLER_PLY][2];
+
+/* 
+ * History tables, indexed by side to move (turn >> 5) and squares.
+ * Scores are halved for each new iteration and whenever one of them
+ * reaches HISTORY_MAX.
+ */
+#define HISTORY_MAX 16384
+#define HISTORY_SIDE(color) ((color) >> 5)
+
+/* butterfly history of quiet moves: [side][from][to] */
+extern THREAD_LOCAL int History[2][128][128];
+/* quiet refutation of the opponent's last move: [side][from][to] */
+extern THREAD_LOCAL int CounterMove[2][128][128];
+/* captures: [side][moving piece][to][captured piece] */
+extern THREAD_LOCAL int CaptureHistory[2][7][128][7];
+
+/* from_to of the move played at each ply of the current line, 0 == null */
+extern THREAD_LOCAL int line_moves[MAX_KILLER_PLY];
 
 void reset_killers(void);
 void update_killers(int from_to);
 void reset_killer_use_count(int ply);
 void pv_2_killer(void);
 
+void reset_history(void);
+void age_history(void);
+void update_history(const move_t *m, int n);
+int counter_move(void);
+
 #endif /* history.h */
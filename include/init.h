@@ -4,6 +4,7 @@
 #define __INIT_H
 
 int setup_board(char *epdbuf);
+int setup_position(char *epdbuf);
 void reset_gamestats(void);
 void reset_test_stats(void);
 void reset_gameoptions(void);
@@ -75,6 +75,7 @@
 #define XB_CMD_ACCEPTED 55
 #define XB_CMD_REJECTED 56
 #define GULLY_CMD_RESET 57
+#define XB_CMD_CORES 58
 
 
 /* returns 1 if buf contains a legal move in this position, 0 otherwise.
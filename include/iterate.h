@@ -7,9 +7,44 @@
 struct iterate_stats_tag {
   int max_depth_reached;
   int reason; /* score: either mate, draw, -mate */
+  int fail_lows; /* aspiration window re-searches (all iterations) */
+  int fail_highs;
+  int ply_fail_lows; /* ... in the current iteration */
+  int ply_fail_highs;
 };
 
-extern struct iterate_stats_tag iterate_stats;
+/* 
+ * Aspiration windows wider than this are opened up completely, as
+ * are bounds reaching into the mate scores.
+ */
+#define ASPIRATION_MAX 800
+#define ASPIRATION_LOWER(b,d) (((d) > ASPIRATION_MAX		\
+				|| (b) <= MATE + MATING_THRESHOLD)	\
+			       ? -INFINITY : (b))
+#define ASPIRATION_UPPER(b,d) (((d) > ASPIRATION_MAX		\
+				|| (b) >= -MATE - MATING_THRESHOLD)	\
+			       ? INFINITY : (b))
+#define IS_MATE_SCORE(s) ((s) < MATE + MATING_THRESHOLD \
+			  || (s) > -MATE - MATING_THRESHOLD)
+/* plies from the root to the mate of a mate score */
+#define MATE_DISTANCE(s) (((s) > 0) ? -MATE - (s) : (s) - MATE)
+/* plies searched beyond a mate before the search stops on it */
+#define MATE_STOP_MARGIN 2
+
+/* 
+ * Easy move: with the clock running, the search stops after an
+ * iteration of at least EASY_MOVE_DEPTH plies if the best move has
+ * not changed, took EASY_MOVE_SHARE percent of the nodes (see 
+ * root_move_share()) and a part of the time given by the divisor is
+ * used up.
+ */
+#define EASY_MOVE_DEPTH 6
+#define EASY_MOVE_SHARE 90
+#define EASY_MOVE_TIME_DIVISOR 3
+
+extern THREAD_LOCAL struct iterate_stats_tag iterate_stats;
+
+struct pos_solve_stat_tag; /* test.h */
 
 int iterate(int depth,enum global_search_state_tag,
 	    struct pos_solve_stat_tag *);
@@ -25,6 +25,8 @@ the square it is currently standing on.
 
 int generate_moves(const int ColorToMove, int index);
 int generate_captures(const int ColorToMove, int index);
+int generate_evasions(const int ColorToMove, int index);
+int generate_move(const int ColorToMove, int from_to, int index);
 
 
 
@@ -3,6 +3,8 @@
 #ifndef __MSTIMER_H
 #define __MSTIMER_H
 
+#include "chess.h" /* THREAD_LOCAL */
+
 /* change NPS if machine according to machine */
 #define NPS 800000
 /* interval after which the time is checked */
@@ -23,6 +25,7 @@ struct game_time_tag {
 
   /* next nodecount triggering checking for time and input  */
   unsigned long next_check; 
+  unsigned long check_nodes; /* NODES_BETWEEN_TIME_CHECK or less */
   unsigned long timestamp; /* 1/100 s - marks start of search, ponder, .. */
   unsigned long stop_time;   /* 1/100 s */
   unsigned long time_allocated;   /* 1/100 s */
@@ -37,7 +40,7 @@ struct game_time_tag {
 };
 
 /* defined in mstimer.c */
-extern struct game_time_tag game_time;
+extern THREAD_LOCAL struct game_time_tag game_time;
 
 /* platform specific timer - returns time in 1/100 s */
 unsigned long get_time(void);
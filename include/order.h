@@ -5,12 +5,82 @@
 
 /* 
    used to order the move_array between index and end_index.
-   keys are assigned for being the TT move, being a winning, even or
-   losing capture and being a killer.
-   Currently, the result is still unordered.
+   keys are assigned for being the TT move, a killer, the counter move
+   and by history. The result is still unordered, see pick().
    */
-int order_moves(int index, int end_index, int tt_from_to, int n);
-
 int order_root_moves(int index, int end_index, int tt_from_to, int n);
 
+/* MVV-LVA keys for captures, also used in quies(). A capture
+   matching tt_from_to (if not 0) goes first. */
+void order_captures(int index, int end_index, int tt_from_to);
+
+/*
+ * Staged move picker for search(): moves are generated and ordered
+ * only as far as they are needed, cut nodes often stop after the hash
+ * move or the first captures. At the root all moves are generated and
+ * ordered by order_root_moves().
+ */
+enum pick_stage_tag {
+  PICK_TT, PICK_GEN_CAPTURES, PICK_CAPTURES, PICK_REFUTATIONS, 
+  PICK_GEN_QUIETS, PICK_QUIETS, PICK_LOSING, PICK_ROOT, PICK_DONE
+};
+
+#define PICK_REFUTATION_MAX 3 /* two killers and the counter move */
+
+struct move_picker_tag {
+  enum pick_stage_tag stage;
+  int index; /* first slot in move_array */
+  int end; /* first unused slot, children search from here */
+  int next; /* next slot to look at in the current stage */
+  int captures; /* captures are in [captures..captures_end) */
+  int captures_end;
+  int tt_slot; /* slot of the hash move, -1 if none */
+  int tt_from_to;
+  int refutation[PICK_REFUTATION_MAX];
+  int n;
+};
+
+void init_picker(struct move_picker_tag *mp, int index, int tt_from_to, 
+		 int n);
+int next_move(struct move_picker_tag *mp);
+
+/* has the picker handed out the hash move or found there is none? */
+#define PICKER_PAST_TT(mp) ((mp)->stage == PICK_GEN_CAPTURES		\
+			    || ((mp)->stage == PICK_TT && !(mp)->tt_from_to))
+
+/*
+ * The legal root moves are kept across the iterations of a search
+ * (one list per search thread). The picker hands them out in list
+ * order: the best move of the last search first, the others by the
+ * size of their subtrees. Only moves in gameopt.searchmoves are
+ * searched if it is not empty.
+ */
+#define MAX_ROOT_MOVES 256
+
+struct root_move_tag {
+  move_t m;
+  unsigned long nodes; /* subtree size in the last search */
+  int score; /* if it raised alpha in the last search, else -INFINITY */
+};
+
+struct root_list_tag {
+  int n;
+  struct root_move_tag moves[MAX_ROOT_MOVES];
+};
+
+extern THREAD_LOCAL struct root_list_tag root_list;
+
+/* builds the list for the current position, returns the number of moves */
+int init_root_moves(void);
+
+/* statistics of a root move after searching it */
+void update_root_move(int from_to, unsigned long nodes, int score);
+
+/* after a search at the root: best_from_to first, then by nodes */
+void sort_root_moves(int best_from_to);
+
+/* percentage of the last search's nodes spent on the first move,
+   used for time allocation in iterate() */
+int root_move_share(void);
+
 #endif /* order.h */
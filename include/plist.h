@@ -19,8 +19,9 @@ typedef unsigned long piece_t;
 
 #define BOARD_NO_ENTRY ((plistentry_t*) 0)
 
-extern int MaxWhitePiece, MaxWhitePawn, MaxBlackPiece, MaxBlackPawn;
-extern plistentry_t PList[];
+extern THREAD_LOCAL int MaxWhitePiece, MaxWhitePawn;
+extern THREAD_LOCAL int MaxBlackPiece, MaxBlackPawn;
+extern THREAD_LOCAL plistentry_t PList[];
 
 #define GET_SQUARE(pl_e) ((square_t)((pl_e) & SQUARE_MASK))
 #define GET_PIECE(pl_e) ((int) ((((unsigned long)(pl_e)) & PIECE_MASK) >> 16))
@@ -1,3 +1,7 @@
 /* $Id: quies.h,v 1.1 1996-09-01 20:29:43 martin Exp $ */
 
+/* quiet checking moves in the first quies plies, see O_QCHECKS_BIT */
+#define QUIES_CHECK_PLIES 1
+#define QUIES_MAX_CHECKS 8 /* ... not more than so many per node */
+
 int quies(int alpha,int beta,int index);
@@ -3,10 +3,22 @@
 #ifndef __REPEAT_H
 #define __REPEAT_H
 
-extern position_hash_t * repetition_head_w;
-extern position_hash_t * repetition_head_b; 
+#define REPETITION_PLIES 100
+#define REP_LIST_MAX_SIZE (REPETITION_PLIES/2 + MAX_SEARCH_DEPTH/2)
+
+extern THREAD_LOCAL position_hash_t * repetition_head_w;
+extern THREAD_LOCAL position_hash_t * repetition_head_b; 
+
+/* root part of the repetition lists, see rep_save() */
+struct rep_snapshot_tag {
+  position_hash_t w[REP_LIST_MAX_SIZE];
+  position_hash_t b[REP_LIST_MAX_SIZE];
+  int w_entries, b_entries;
+};
 
 void reset_rep_heads(void);
+void rep_save(struct rep_snapshot_tag *rs);
+void rep_restore(const struct rep_snapshot_tag *rs);
 void rep_show_offset(void);
 int repetition_check(const int ply, const position_hash_t *hash_value);
 int draw_by_repetition(const position_hash_t *hash_value);
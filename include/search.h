@@ -3,6 +3,40 @@
 #ifndef __SEARCH_H
 #define __SEARCH_H
 
+/* late move reductions, see gameopt.lmr_* */
+#define DEFAULT_LMR_MOVES 3
+#define DEFAULT_LMR_DEPTH 3
+
+/* internal iterative deepening, see gameopt.iid_depth */
+#define DEFAULT_IID_DEPTH 5
+#define IID_REDUCTION 2
+
+/* 
+ * singular extensions, see gameopt.singular_depth: the hash entry
+ * may be so many plies short of the depth, the other moves have to
+ * fail low below its score minus the margin.
+ */
+#define DEFAULT_SINGULAR_DEPTH 8
+#define SINGULAR_HEIGHT_SLACK 3
+#define SINGULAR_MARGIN(n) (3 * (n))
+
+/* 
+ * extensions in fractions of a ply, see gameopt.ext_*. Along a path
+ * at most one ply per ply searched may be added.
+ */
+#define EXTENSION_ONE_PLY 4
+#define DEFAULT_EXT_CHECK 3
+#define DEFAULT_EXT_RECAPTURE 2
+#define DEFAULT_EXT_PAWN 3
+#define DEFAULT_EXT_SINGLE 2
+
+/* enhanced transposition cutoffs with so many plies left */
+#define ETC_DEPTH 4
+
+/* ProbCut, see gameopt.probcut_* */
+#define DEFAULT_PROBCUT_MARGIN 200
+#define DEFAULT_PROBCUT_REDUCTION 4
+
 int search(const int alpha,const int beta,int n,const int index);
 void pick(int,int);
 
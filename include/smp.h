@@ -0,0 +1,43 @@
+/* $Id$ */
+
+#ifndef __SMP_H
+#define __SMP_H
+
+/* 
+ * Parallel search ("lazy smp"): helper threads search the same root
+ * position as the main thread, every one with its own board, move
+ * stack and killers. They communicate only through the shared
+ * transposition table.
+ */
+
+#include "transref.h" /* ph_entry_t */
+
+#define MAX_THREADS 64
+
+/* 0 for the main thread, 1 .. gameopt.threads-1 for helpers */
+extern THREAD_LOCAL int search_thread_id;
+
+#define IS_MAIN_THREAD (search_thread_id == 0)
+
+/* 
+ * Pawn tables of the helpers, MAX_THREADS entries which are filled
+ * as needed and kept across searches. The owner frees them. NULL:
+ * tables of the calling thread, kept as long as the process runs
+ * (the program's main thread). Engines of the library bring their
+ * own, see gully.c.
+ */
+extern THREAD_LOCAL ph_entry_t ** helper_ptables;
+
+/* 
+ * Starts gameopt.threads - 1 helpers on the current root position, 
+ * searching up to depth plies. Called by iterate().
+ */
+void smp_start(int depth);
+
+/* 
+ * Stops and joins the helpers. Their node counts are added
+ * to gamestat of the main thread.
+ */
+void smp_stop(void);
+
+#endif /* smp.h */
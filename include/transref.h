@@ -3,6 +3,8 @@
 #ifndef __TRANSREF_H
 #define __TRANSREF_H
 
+#include <limits.h> /* ULONG_MAX */
+
 #include "chess.h"
 
 #define TT_EMPTY    0x00000000
@@ -11,12 +13,21 @@
 #define UPPER_BOUND 0x00040000
 #define TT_MOVE_USEFUL (EXACT_VALUE | LOWER_BOUND)
 
-#define GET_TT_FLAG(tt) ((tt).hf & 0xffff0000)
-#define GET_TT_HEIGHT(tt) ((tt).hf & 0x0000ffff)
+/* eval field of entries without a static evaluation */
+#define TT_NO_EVAL (-INFINITY)
+
+/* main table size in MB, any size in range will do */
+#define TT_MIN_MB 1
+#define DEFAULT_TT_MB 32
+#if ULONG_MAX > 0xffffffffUL
+#define TT_MAX_MB (256 * 1024) /* 2^32 buckets */
+#else
+#define TT_MAX_MB 2047
+#endif
+#define TT_MB_BUCKETS(mb) ((unsigned long) (mb) << 14) /* 64 byte buckets */
 
-#define TT_MIN_BITS 10 
-#define DEFAULT_TT_BITS 21 /* 2^21 entries: ~ 40 MB */
-#define TT_MAX_BITS 24 /* ~ 320 MB  */
+/* the old --transref <bits>: 2^bits * 16 bytes */
+#define TT_BITS_TO_MB(b) ((b) > 16 ? 1 << MIN((b) - 16, 30) : TT_MIN_MB)
 
 /* ret values of tt_store */
 #define TT_ST_MATCH 0
@@ -28,17 +39,87 @@
 #define TT_RT_FOUND 1
 #define TT_RT_NOT_FOUND 0
 
+/* 
+ * A bucket holds one cache line of entries, the low bits of
+ * signature.part_one select the bucket. An entry is packed into
+ * three words:
+ * check: signature.part_two ^ data ^ data2, see TT_ENTER in transref.c
+ * data:  bits 0-15 from_to, 16-31 score
+ * data2: bits 0-15 static eval, 16-23 height, 24-26 flag >> 16,
+ *        27-31 generation
+ * Scores and evals are clipped to 16 bits.
+ */
 typedef struct tt_entry_tag {
-  position_hash_t signature; /* 64 bit */
-  int ft; /* from_to - stored move 32 bit */
-  int score;
-  unsigned int hf;  /* contains flags and height */
+  unsigned int check;
+  unsigned int data;
+  unsigned int data2;
 } tt_entry_t;
 
-extern tt_entry_t * ttable;
+#define TT_BUCKET_ENTRIES 5
+
+typedef struct tt_bucket_tag {
+  tt_entry_t entry[TT_BUCKET_ENTRIES];
+  unsigned int unused; /* pads to 64 bytes */
+} tt_bucket_t;
+
+#define TT_GENERATION_BITS 5
+
+/* the table of the current engine, see engine.c */
+extern THREAD_LOCAL tt_bucket_t * ttable;
+extern THREAD_LOCAL unsigned long tt_buckets;
+/* advanced by tt_new_search(), older entries are replaced first */
+extern THREAD_LOCAL unsigned int tt_generation;
 
-int init_transref_table(int);
-/* returns -1 on failure */
+/* 
+ * Allocates ttable with a size of mb megabytes, on huge pages if the
+ * system has them. Returns -1 on failure.
+ */
+int init_transref_table(int mb);
+
+/* frees a table of init_transref_table() with that many buckets */
+void tt_free_table(tt_bucket_t *, unsigned long buckets);
+
+/* called before each search, ages the entries of former searches */
+void tt_new_search(void);
+
+/* permille of a sample of entries written by the current search */
+int tt_hashfull(void);
+
+/* 
+ * Starts loading the main and pawn table slots of the position after
+ * move m into the cache. Called before make_move() so that the load
+ * overlaps with it, the child's probes then find the slots cached.
+ */
+void prefetch_child(const move_t * m);
+
+/* 
+ * Snapshots of the main table for long analysis sessions. tt_save()
+ * writes the table with a header on entry format and hash keys,
+ * tt_load() reads it back (resizing the table to the snapshot's
+ * size), tt_map() maps the file instead of reading it. All return
+ * -1 on failure. A snapshot of another format or one shorter than
+ * its header says is rejected before the old table is touched; only
+ * a read error while loading leaves the table cleared.
+ */
+int tt_save(const char * file);
+int tt_load(const char * file);
+int tt_map(const char * file);
+
+/* set by loading a snapshot: setup_position() does not clear then */
+extern int tt_keep_on_setup;
+
+/* --hashfile: mapped at startup instead of a new table */
+extern char * tt_snapshot_file;
+
+/* 
+ * Main table in the POSIX shared memory segment name, created with
+ * mb megabytes by the first process. Cooperating processes probe and
+ * store into the same table. Returns -1 on failure.
+ */
+int tt_share(const char * name, int mb);
+
+/* --hashshm: the segment for tt_share() at startup */
+extern char * tt_shared_name;
 
 int tt_store(const position_hash_t * sig,int from_to,int score,int h,
 	     int flag);
@@ -48,7 +129,20 @@ int tt_retrieve(const position_hash_t * sig,int *from_to,int *score,
 		int *h,int *flag);
 /* returns TT_RT_FOUND or TT_RT_NOT_FOUND */
 
-/* to make test suites deterministic */
+/* 
+ * Entries of quiescence search have height 0 and carry the static
+ * evaluation. They never replace entries of the main search.
+ */
+int tt_store_quies(const position_hash_t * sig,int from_to,int score,
+		   int eval,int flag);
+/* returns TT_ST_STORED, TT_ST_REPLACED, TT_NO_TABLE or TT_ST_MATCH
+   if a deeper entry was kept */
+
+int tt_retrieve_quies(const position_hash_t * sig,int *from_to,int *score,
+		      int *eval,int *flag);
+/* returns TT_RT_FOUND or TT_RT_NOT_FOUND, eval may be TT_NO_EVAL */
+
+/* to make test suites deterministic, clears large tables in parallel */
 int tt_clear(void);
 /* should return 0 on error */
 
@@ -88,7 +182,8 @@ typedef struct ph_entry_tag {
   unsigned int bp_map; /* XXX not used yet */
 } ph_entry_t;
 
-extern ph_entry_t * ptable;
+/* every search thread has its own pawn table, see smp.c */
+extern THREAD_LOCAL ph_entry_t * ptable;
 
 /* 
  * Sets everything to 0 except for the first element. 
@@ -96,6 +191,9 @@ extern ph_entry_t * ptable;
 */
 int init_pawn_table(int);
 
+/* pawn table for a helper thread, NULL on failure */
+ph_entry_t * ph_new_table(void);
+
 /* this is in "always replace" mode */
 int ph_store(const position_hash_t * sig,int score,int wp);
 
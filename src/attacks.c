@@ -81,7 +81,7 @@ we use another matrix to look up the direction of the move required
      };
 
 /* data structure for static exchange evaluator */
-static struct see_array_tag {
+static THREAD_LOCAL struct see_array_tag {
   piece_t direct[2][16];
   piece_t indirect[2][16];
   int direct_counter[2];
@@ -104,6 +104,8 @@ static struct see_array_tag {
 /* forward decl */
 int fill_see_array(int color, const square_t sq);
 void reset_see_array(void);
+static int see_exchange(int attacking_color,move_t * m,int bounded,
+			int threshold);
 
 /* does color ctm attack square sq?
 * We search our piece list for this and check SqRel for a possible
@@ -183,6 +185,115 @@ attacks(int ctm,square_t sq)
   return NOT_ATTACKED;
 }
 
+/* 
+ * Like attacks(), but counts the attackers of color ctm (stops at
+ * two, which is all a check evasion needs to know) and returns the
+ * square of one of them in from.
+ */
+int
+attackers(int ctm,square_t sq,square_t *from)
+{
+  int i, n = 0;
+  register plistentry_t *PListPtr, *StopPtr;
+  int pawn_dir[2];
+
+  if(ctm==WHITE)
+    {
+      PListPtr=PList; StopPtr=PList+MaxWhitePiece;
+      pawn_dir[0] = DOWN_LEFT; pawn_dir[1] = DOWN_RIGHT;
+    }
+  else
+    {
+      PListPtr=PList+BPIECE_START_INDEX; StopPtr=PList+MaxBlackPiece;
+      pawn_dir[0] = UP_LEFT; pawn_dir[1] = UP_RIGHT;
+    }
+
+  assert(PListPtr != StopPtr);
+  do
+    {
+      if(*PListPtr != NO_PIECE)
+	if(SqRel[GET_SQUARE(*PListPtr)+128-sq]
+	   & PieceBits[GET_PIECE(*PListPtr)])
+	  {
+	    int next=GET_SQUARE(*PListPtr);
+
+	    if((GET_PIECE(*PListPtr) != KNIGHT) &&
+	       (GET_PIECE(*PListPtr) != KING))
+	      {
+		int j=vector[next+128-sq];
+
+		do next+=j;
+		while(next != sq && BOARD[next] == 0);
+	      }
+	    if(GET_PIECE(*PListPtr) == KNIGHT ||
+	       GET_PIECE(*PListPtr) == KING || next == sq)
+	      {
+		*from = GET_SQUARE(*PListPtr);
+		if(++n == 2) return n;
+	      }
+	  }
+    }
+  while(++PListPtr != StopPtr);
+
+  for(i = 0; i < 2; i++)
+    {
+      int p = sq + pawn_dir[i];
+
+      if(((p & 0x88) == 0) && BOARD[p] != BOARD_NO_ENTRY
+	 && (GET_PIECE(*BOARD[p]) == PAWN)
+	 && ((PLIST_OFFSET(BOARD[p]) & BLACK) == (ctm & BLACK)))
+	{
+	  *from = (square_t) p;
+	  if(++n == 2) return n;
+	}
+    }
+  return n;
+}
+
+/* is sq on the rank, file or diagonal strictly between a and b? */
+int
+between(square_t a,square_t b,square_t sq)
+{
+  int j, next = a;
+
+  if(!(SqRel[a+128-b] & Q))
+    return 0;
+
+  j=vector[a+128-b];
+  for(;;)
+    {
+      next+=j;
+      if(next == b) return 0;
+      if(next == sq) return 1;
+    }
+}
+
+/*
+ * Cheap filter for moves giving check to the king on ksq: the moved
+ * piece is on a line with the king afterwards or leaves one (a
+ * discovered check). Only blockers are ignored, so there are no
+ * false negatives. Call before making the move.
+ */
+int
+maybe_check(const move_t *m,square_t ksq)
+{
+  square_t from = GET_FROM(m->from_to), to = GET_TO(m->from_to);
+  piece_t piece = GET_PIECE(*BOARD[from]);
+
+  if(m->special == CASTLING || (SqRel[from+128-ksq] & Q))
+    return 1;
+
+  if(piece == PAWN)
+    {
+      int d = ksq - to;
+
+      if(PLIST_OFFSET(BOARD[from]) & BLACK)
+	return d == DOWN_LEFT || d == DOWN_RIGHT;
+      return d == UP_LEFT || d == UP_RIGHT;
+    }
+  return (SqRel[to+128-ksq] & PieceBits[piece]) != 0;
+}
+
 /* 
    static exchange evaluator.
    m is the capture which is evaluated. Must be called before
@@ -207,6 +318,41 @@ attacks(int ctm,square_t sq)
 
 int
 see(int attacking_color,move_t * m)
+{
+  return see_exchange(attacking_color, m, 0, 0);
+}
+
+/*
+  Is see() at least threshold? Stops as soon as the answer is known:
+  the exchange keeps narrowing the range [bad_score..good_score] the
+  result lies in.
+  */
+
+int
+see_ge(int attacking_color,move_t * m,int threshold)
+{
+  return see_exchange(attacking_color, m, 1, threshold) >= threshold;
+}
+
+/* most material a capture or promotion can win, for delta pruning */
+
+int
+capture_gain(const move_t * m)
+{
+  int gain = see_piece_value[GET_CAP(m->cap_pro)];
+
+  if(GET_PRO(m->cap_pro))
+    gain += see_piece_value[GET_PRO(m->cap_pro)] - see_piece_value[PAWN];
+  return gain;
+}
+
+/* 
+   see() if bounded is 0, otherwise returns early once the result is
+   known to be above or below threshold.
+   */
+
+static int
+see_exchange(int attacking_color,move_t * m,int bounded,int threshold)
 {
   square_t sq = GET_TO(m->from_to);
   square_t a_from = GET_FROM(m->from_to);
@@ -234,7 +380,9 @@ see(int attacking_color,move_t * m)
 #endif
 
   /* note: no score - risk > 0 shortcut, since the *exact* value 
-     of the capture is needed */
+     of the capture is needed. Unless bounded: */
+  if(bounded && (bad_score >= threshold || good_score < threshold))
+    return (bad_score >= threshold) ? bad_score : good_score;
 
   /* The capture in question should not be executed on the board until
      after see. Therefore, the piecelist is manipulated "by hand" here,
@@ -366,6 +514,8 @@ see(int attacking_color,move_t * m)
 	/* adjust bad_score */
 	if(score > bad_score)
 	  bad_score = score;
+	if(bounded && bad_score >= threshold)
+	  return bad_score;
 	
 	/* A T T A C K E R */
 	
@@ -429,6 +579,8 @@ see(int attacking_color,move_t * m)
 	/* adjust good_score */
 	if(score < good_score)
 	  good_score = score;
+	if(bounded && good_score < threshold)
+	  return good_score;
 
 	/* is it a winner? */
 	if(score - risk > 0)
@@ -79,11 +79,12 @@ struct bookstat_tag bookstat;
 int 
 book(void)
 {
-  static book_position_t buffer[BOOK_CLUSTER_SIZE];
-  static move_t book_moves[200];
-  static move_t selected[200];
-  static int selected_order[200], selected_status[200], book_development[200];
-  static int book_order[200], book_status[200], evaluations[200];
+  static THREAD_LOCAL book_position_t buffer[BOOK_CLUSTER_SIZE];
+  static THREAD_LOCAL move_t book_moves[200];
+  static THREAD_LOCAL move_t selected[200];
+  static THREAD_LOCAL int selected_order[200], selected_status[200];
+  static THREAD_LOCAL int book_development[200];
+  static THREAD_LOCAL int book_order[200], book_status[200], evaluations[200];
   int m1_status,status;
   int done, i, j, last_move, temp, which;
   int cluster, test;
@@ -9,6 +9,8 @@
 #include "movegen.h"
 #include "tables.h" /* get_piece_material */
 #include "transref.h" /* UPPER_BOUND etc. */
+#include "order.h" /* root_list */
+#include "iterate.h" /* iterate_stats */
 
 void
 fprint_board(FILE *where)
@@ -167,6 +169,102 @@ sprint_move(char * strbuf, move_t *m)
 }
 
 
+int
+parse_coordinate_moves(const char *s, int *moves, int max)
+{
+  int n = 0;
+
+  while (*s) {
+    if (*s == ' ' || *s == ',') {
+      s++;
+      continue;
+    }
+    if (n >= max 
+	|| s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8'
+	|| s[2] < 'a' || s[2] > 'h' || s[3] < '1' || s[3] > '8')
+      return -1;
+    moves[n++] = FROM_TO(((s[1] - '1') << 4) + s[0] - 'a',
+			 ((s[3] - '1') << 4) + s[2] - 'a');
+    s += 4;
+    /* all promotions of a pawn move are searched */
+    if (*s && strchr("qrbnQRBN", *s))
+      s++;
+  }
+  return n;
+}
+
+void
+fprint_root_moves(FILE * where, int max)
+{
+  int i;
+
+  fprintf(where, "root moves (best %d%%):", root_move_share());
+  for (i = 0; i < root_list.n && i < max; i++) {
+    struct root_move_tag *r = &root_list.moves[i];
+
+    fprintf(where, " ");
+    fprint_move(where, &r->m);
+    if (r->score > -INFINITY)
+      fprintf(where, "%+d ", r->score);
+    fprintf(where, "(%luK)", r->nodes / 1000);
+  }
+  fprintf(where, "\n");
+}
+
+/* 
+ * The counters of gamestat and iterate_stats after a search of time
+ * seconds. New counters are added here, not to the callers.
+ */
+void
+fprint_gamestats(FILE * where, double time)
+{
+  unsigned long nodes = gamestat.quies_nps + gamestat.search_nps;
+
+  fprintf(where, "evals:%d (full:%d lazy:%.2f%%), time: %.2f [%.2f Knps]\n",
+	  gamestat.evals, gamestat.full_evals,
+	  gamestat.evals ? 100 - (100.0 * gamestat.full_evals 
+				  / gamestat.evals) : 0.0,
+	  time, (time > 0) ? nodes / (time * 1000) : 0.0);
+  fprintf(where, "Nodes in search: %.1f million, quies: %.1f million "
+	  "(%.2f%%)\n", gamestat.search_nps / 1000000.0, 
+	  gamestat.quies_nps / 1000000.0,
+	  nodes ? 100.0 * gamestat.quies_nps / nodes : 0.0);
+  fprintf(where, "moves in search - generated: %lu million, "
+	  "looked at: %lu million (%.2f%%)\n",
+	  gamestat.moves_generated_in_search / 1000000,
+	  gamestat.moves_looked_at_in_search / 1000000,
+	  gamestat.moves_generated_in_search ? 
+	  100.0 * gamestat.moves_looked_at_in_search 
+	  / gamestat.moves_generated_in_search : 0.0);
+  fprintf(where, "pawn hash: hits: %u misses: %u (%.3f%%)\n",
+	  gamestat.p_hash_hits, gamestat.p_hash_misses,
+	  (gamestat.p_hash_hits + gamestat.p_hash_misses) ?
+	  100.0 * gamestat.p_hash_hits 
+	  / (gamestat.p_hash_hits + gamestat.p_hash_misses) : 0.0);
+  fprintf(where, "pvs re-searches: %lu, lmr: %lu reduced, %lu re-searched\n",
+	  gamestat.pvs_re_searches, gamestat.lmr_reductions,
+	  gamestat.lmr_re_searches);
+  fprintf(where, "aspiration re-searches: %d fail lows, %d fail highs\n",
+	  iterate_stats.fail_lows, iterate_stats.fail_highs);
+  fprintf(where, "pruned: futility %lu, razoring %lu, late moves %lu\n",
+	  gamestat.futility_prunes, gamestat.razor_cutoffs,
+	  gamestat.lmp_prunes);
+  fprintf(where, "iid searches: %lu, quies: %lu in check, %lu quiet checks\n",
+	  gamestat.iid_searches, gamestat.quies_evasions,
+	  gamestat.quies_checks);
+  fprintf(where, "null move: %lu cutoffs, %lu verified\n",
+	  gamestat.null_cutoffs, gamestat.null_verifications);
+  fprintf(where, "singular: %lu searches, %lu extensions, probcut: %lu, "
+	  "etc: %lu\n", gamestat.singular_searches, 
+	  gamestat.singular_extensions, gamestat.probcut_cutoffs,
+	  gamestat.etc_cutoffs);
+  fprintf(where, "hash hits: search %lu of %lu, quies %lu of %lu, "
+	  "%d permille full\n",
+	  gamestat.tt_hits, gamestat.tt_probes,
+	  gamestat.tt_quies_hits, gamestat.tt_quies_probes, 
+	  tt_hashfull());
+}
+
 /* xboard wrapper */
 int 
 fprint_computer_move(FILE *where, move_t *m)
@@ -0,0 +1,102 @@
+/* $Id$ */
+
+/* 
+ * Engine contexts: copy the state of an engine from and to the 
+ * thread local globals the search works on. See engine.h.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "chess.h"
+#include "engine.h"
+#include "board.h"
+#include "evaluate.h" /* max_pos_score */
+
+static int
+plist_offset_or_none(const plistentry_t * ple)
+{
+  return (ple == BOARD_NO_ENTRY) ? -1 : PLIST_OFFSET(ple);
+}
+
+static plistentry_t *
+plist_entry_or_none(int offset)
+{
+  return (offset < 0) ? BOARD_NO_ENTRY : &PList[offset];
+}
+
+void
+engine_save(struct engine_tag *e)
+{
+  int i;
+
+  assert(current_ply == 0);
+
+  memcpy(e->plist, PList, sizeof(e->plist));
+  for (i = 0; i < 128; i++) 
+    e->board[i] = plist_offset_or_none(BOARD[i]);
+
+  e->max_white_piece = MaxWhitePiece;
+  e->max_white_pawn = MaxWhitePawn;
+  e->max_black_piece = MaxBlackPiece;
+  e->max_black_pawn = MaxBlackPawn;
+
+  /* undo information of the root move points into PList */
+  e->flags = move_flags[0];
+  e->just_deleted = plist_offset_or_none(move_flags[0].just_deleted_entry);
+  e->last_promoted = plist_offset_or_none(move_flags[0].last_promoted);
+
+  e->turn = turn;
+  e->max_pos_score = max_pos_score;
+  rep_save(&e->rep);
+
+  e->phase = game_phase;
+  e->opt = gameopt;
+  e->time = game_time;
+
+  e->ttable = ttable;
+  e->tt_buckets = tt_buckets;
+  e->tt_generation = tt_generation;
+  e->ptable = ptable;
+  e->abort_flag = abort_flag;
+
+  e->stat = gamestat;
+  memcpy(e->pv, principal_variation[0], sizeof(e->pv));
+}
+
+void
+engine_load(const struct engine_tag *e)
+{
+  int i;
+
+  memcpy(PList, e->plist, sizeof(e->plist));
+  for (i = 0; i < 128; i++) 
+    BOARD[i] = plist_entry_or_none(e->board[i]);
+
+  MaxWhitePiece = e->max_white_piece;
+  MaxWhitePawn = e->max_white_pawn;
+  MaxBlackPiece = e->max_black_piece;
+  MaxBlackPawn = e->max_black_pawn;
+
+  move_flags[0] = e->flags;
+  move_flags[0].just_deleted_entry = plist_entry_or_none(e->just_deleted);
+  move_flags[0].last_promoted = plist_entry_or_none(e->last_promoted);
+
+  turn = e->turn;
+  current_ply = 0;
+  max_pos_score = e->max_pos_score;
+  rep_restore(&e->rep);
+
+  game_phase = e->phase;
+  gameopt = e->opt;
+  game_time = e->time;
+
+  ttable = e->ttable;
+  tt_buckets = e->tt_buckets;
+  tt_generation = e->tt_generation;
+  ptable = e->ptable;
+  abort_flag = e->abort_flag;
+
+  gamestat = e->stat;
+  memcpy(principal_variation[0], e->pv, sizeof(e->pv));
+}
@@ -51,10 +51,10 @@ int evaluate_bn_mate(int wpi,int bpi);
 static char sq_buf[3];
 
 /* characteristics of the material distribution */
-static unsigned int wpiece_7sig, bpiece_7sig;
+static THREAD_LOCAL unsigned int wpiece_7sig, bpiece_7sig;
 
 /* initially, that is */
-int max_pos_score = PAWNVALUE;
+THREAD_LOCAL int max_pos_score = PAWNVALUE;
 
 /*
  * The long way to get a material score. Used by initialization (and
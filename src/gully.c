@@ -0,0 +1,319 @@
+/* $Id$ */
+
+/*
+ * Library interface, see gully.h. Every gully_t owns an engine
+ * context (engine.h) which is loaded into the thread local search
+ * state of the calling thread for each call and saved back afterwards.
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined (UNIX)
+#include <pthread.h>
+#endif
+
+#include "chess.h"
+#include "gully.h"
+#include "engine.h"
+#include "init.h"
+#include "hash.h"
+#include "helpers.h"
+#include "history.h" /* reset_killers, reset_history */
+#include "test.h" /* iterate.h needs pos_solve_stat_tag */
+#include "iterate.h"
+#include "movegen.h" /* GET_FROM */
+#include "chessio.h" /* square_name */
+#include "smp.h" /* MAX_THREADS, helper_ptables */
+
+#ifdef UNIX
+/* see logger.c, normally defined in main.c */
+int use_syslog = 0;
+#endif
+
+/* 1000 hours in 1/10 s: searches limited by depth or nodes only */
+#define NO_TIME_LIMIT 36000000
+
+#define FEN_MAXSIZE 100
+
+struct gully_tag {
+  struct engine_tag e;
+  volatile int stop; /* abort_search of this engine */
+  int score;
+  ph_entry_t * helper_ptables[MAX_THREADS]; /* see smp.h */
+};
+
+/*
+ * The board setup code trusts its input, so check the shape of
+ * the placement field and the side to move here.
+ */
+static int
+fen_ok(const char *fen)
+{
+  int ranks = 1, files = 0, wk = 0, bk = 0, white = 0, black = 0;
+  const char *p;
+
+  if (strlen(fen) > FEN_MAXSIZE)
+    return 0;
+
+  for (p = fen; *p && *p != ' '; p++) {
+    if (*p == '/') {
+      if (files != 8) return 0;
+      ranks++;
+      files = 0;
+    }
+    else if (*p >= '1' && *p <= '8')
+      files += *p - '0';
+    else if (strchr("KQRBNP", *p)) {
+      files++;
+      white++;
+      wk += (*p == 'K');
+    }
+    else if (strchr("kqrbnp", *p)) {
+      files++;
+      black++;
+      bk += (*p == 'k');
+    }
+    else
+      return 0;
+    if (files > 8) return 0;
+  }
+
+  if (ranks != 8 || files != 8 || wk != 1 || bk != 1
+      || white > 16 || black > 16)
+    return 0;
+
+  while (*p == ' ') p++;
+  return (*p == 'w' || *p == 'b');
+}
+
+int
+gully_init(void)
+{
+  init_hash();
+  return 1;
+}
+
+struct new_engine_tag {
+  gully_t *g;
+  int hash_mb;
+  int ok;
+};
+
+/* sets up the engine in the thread local state of the calling thread */
+static void *
+build_engine(void *arg)
+{
+  struct new_engine_tag *n = (struct new_engine_tag *) arg;
+  gully_t *g = n->g;
+
+  reset_gameoptions();
+  RESET_OPTION(O_POST_BIT);
+  RESET_OPTION(O_PONDER_BIT);
+  RESET_OPTION(O_BOOK_BIT);
+  SET_OPTION(O_EMBEDDED_BIT);
+  if (n->hash_mb)
+    gameopt.transref_size = n->hash_mb;
+
+  if (init_transref_table(gameopt.transref_size) == -1)
+    return NULL;
+  if (init_pawn_table(0) == -1) {
+    tt_free_table(ttable, tt_buckets);
+    return NULL;
+  }
+  tt_clear();
+  ph_clear();
+
+  abort_flag = &g->stop;
+  setup_position(NULL);
+
+  engine_save(&g->e);
+  n->ok = 1;
+  return NULL;
+}
+
+gully_t *
+gully_new(int hash_mb)
+{
+  struct new_engine_tag n;
+#if defined (UNIX)
+  pthread_t t;
+#endif
+
+  if ((n.g = (gully_t *) calloc(1, sizeof(gully_t))) == NULL)
+    return NULL;
+  n.hash_mb = hash_mb;
+  n.ok = 0;
+
+#if defined (UNIX)
+  /* on a thread of its own, the caller's search state is left alone */
+  if (pthread_create(&t, NULL, build_engine, &n) == 0)
+    pthread_join(t, NULL);
+#else
+  build_engine(&n);
+#endif
+
+  if (!n.ok) {
+    free(n.g);
+    return NULL;
+  }
+  return n.g;
+}
+
+void
+gully_delete(gully_t *g)
+{
+  int i;
+
+  if (g == NULL)
+    return;
+  tt_free_table(g->e.ttable, g->e.tt_buckets);
+  free(g->e.ptable);
+  for (i = 0; i < MAX_THREADS; i++)
+    free(g->helper_ptables[i]);
+  free(g);
+}
+
+int
+gully_set_fen(gully_t *g, const char *fen)
+{
+  char buf[FEN_MAXSIZE + 1];
+  int ok;
+
+  assert(g);
+
+  if (!fen_ok(fen))
+    return 0;
+  strcpy(buf, fen);
+
+  engine_load(&g->e);
+  ok = setup_position(buf);
+
+  /* keep the old position on failure */
+  if (ok) {
+    reset_killers();
+    reset_history();
+    clear_pv(0);
+    engine_save(&g->e);
+  }
+  return ok;
+}
+
+void
+gully_set_threads(gully_t *g, int threads)
+{
+  assert(g);
+  g->e.opt.threads = MIN(MAX(threads, 1), MAX_THREADS);
+}
+
+int
+gully_set_searchmoves(gully_t *g, const char *moves)
+{
+  int n = 0;
+
+  assert(g);
+
+  if (moves && (n = parse_coordinate_moves(moves, g->e.opt.searchmoves,
+					   MAX_SEARCHMOVES)) < 0) {
+    g->e.opt.searchmoves[0] = 0;
+    return 0;
+  }
+  g->e.opt.searchmoves[n] = 0;
+  return 1;
+}
+
+void
+gully_clear_hash(gully_t *g)
+{
+  assert(g);
+  engine_load(&g->e);
+  tt_clear();
+  ph_clear();
+}
+
+int
+gully_search(gully_t *g, int depth, unsigned long nodes, long msecs)
+{
+  assert(g);
+
+  engine_load(&g->e);
+
+  if (depth <= 0 || depth > MAX_SEARCH_DEPTH >> 1)
+    depth = MAX_SEARCH_DEPTH >> 1;
+
+  gameopt.maxnodes = nodes;
+  game_time.use_game_time = 0;
+  game_time.time_per_move = (msecs > 0) ? MAX(msecs / 100, 1) : NO_TIME_LIMIT;
+  game_time.check_nodes = nodes ?
+    MIN(NODES_BETWEEN_TIME_CHECK, nodes / 16 + 1) : NODES_BETWEEN_TIME_CHECK;
+  game_time.next_check = 0;
+
+  /* killers and history are kept per thread, not per engine */
+  reset_killers();
+  reset_history();
+  reset_gamestats();
+  timestamp();
+
+  /* the helpers' pawn tables go with the engine, not the thread */
+  helper_ptables = g->helper_ptables;
+  g->score = iterate(depth, SEARCHING, NULL);
+  global_search_state = IDLING;
+  helper_ptables = NULL;
+
+  engine_save(&g->e);
+  return g->score;
+}
+
+int
+gully_score(const gully_t *g)
+{
+  assert(g);
+  return g->score;
+}
+
+unsigned long
+gully_nodes(const gully_t *g)
+{
+  assert(g);
+  return (unsigned long) g->e.stat.search_nps + g->e.stat.quies_nps;
+}
+
+int
+gully_hashfull(gully_t *g)
+{
+  assert(g);
+  engine_load(&g->e);
+  return tt_hashfull();
+}
+
+int
+gully_pv(const gully_t *g, char *buf, int len)
+{
+  int i, used = 0;
+
+  assert(g && buf && len > 0);
+
+  buf[0] = '\0';
+  for (i = 0; i < MAX_SEARCH_DEPTH && g->e.pv[i].from_to; i++) {
+    const move_t *m = &g->e.pv[i];
+    char from[3], to[3], move[8];
+    int pro = GET_PRO(m->cap_pro);
+
+    square_name(GET_FROM(m->from_to), from);
+    square_name(GET_TO(m->from_to), to);
+    sprintf(move, "%s%s%s", i ? " " : "", from, to);
+    if (pro) {
+      int n = strlen(move);
+      move[n] = tolower(piece_name(pro));
+      move[n + 1] = '\0';
+    }
+    if (used + (int) strlen(move) >= len)
+      break;
+    strcpy(buf + used, move);
+    used += strlen(move);
+  }
+  return i;
+}
@@ -0,0 +1,115 @@
+/* $Id$ */
+
+/*
+ * Example and test of the library interface (gully.h): two engines
+ * search different positions side by side, each on a thread of its
+ * own. Every engine keeps its own state, so a search has to give the
+ * same nodes, score and principal variation whether another engine
+ * is searching at the same time or not.
+ *
+ * Build with "make gullytest", "make check" runs it. Exits with 0 if
+ * all results agree.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "gully.h"
+
+#define ENGINES 2
+#define DEPTH 8
+#define HASH_MB 8
+#define PV_SIZE 256
+
+struct job_tag {
+  gully_t *g;
+  const char *fen;
+  int score;
+  unsigned long nodes;
+  char pv[PV_SIZE];
+};
+
+static const char *fens[ENGINES] = {
+  "r3r1k1/ppqb1ppp/8/4p1NQ/8/2P5/PP3PPP/R3R1K1 b - - 0 1",
+  "2r3k1/pppR1pp1/4p3/4P1P1/5P2/1P4K1/P1P5/8 w - - 0 1"
+};
+
+static void *run_job(void *arg);
+
+/* one search from a cleared table */
+static void *
+run_job(void *arg)
+{
+  struct job_tag *j = (struct job_tag *) arg;
+
+  gully_clear_hash(j->g);
+  if (!gully_set_fen(j->g, j->fen)) {
+    j->score = 0;
+    j->nodes = 0;
+    strcpy(j->pv, "(bad fen)");
+    return NULL;
+  }
+  j->score = gully_search(j->g, DEPTH, 0, 0);
+  j->nodes = gully_nodes(j->g);
+  gully_pv(j->g, j->pv, PV_SIZE);
+  return NULL;
+}
+
+int
+main(void)
+{
+  struct job_tag alone[ENGINES], together[ENGINES];
+  pthread_t threads[ENGINES];
+  gully_t *g[ENGINES];
+  int i, failed = 0;
+
+  if (!gully_init()) {
+    fprintf(stderr, "gully_init failed\n");
+    return 1;
+  }
+  for (i = 0; i < ENGINES; i++)
+    if ((g[i] = gully_new(HASH_MB)) == NULL) {
+      fprintf(stderr, "gully_new failed\n");
+      return 1;
+    }
+
+  /* one engine after the other */
+  for (i = 0; i < ENGINES; i++) {
+    alone[i].g = g[i];
+    alone[i].fen = fens[i];
+    run_job(&alone[i]);
+  }
+
+  /* all at the same time */
+  for (i = 0; i < ENGINES; i++) {
+    together[i].g = g[i];
+    together[i].fen = fens[i];
+    if (pthread_create(&threads[i], NULL, run_job, &together[i])) {
+      fprintf(stderr, "pthread_create failed\n");
+      return 1;
+    }
+  }
+  for (i = 0; i < ENGINES; i++)
+    pthread_join(threads[i], NULL);
+
+  for (i = 0; i < ENGINES; i++) {
+    int same = alone[i].score == together[i].score
+      && alone[i].nodes == together[i].nodes
+      && !strcmp(alone[i].pv, together[i].pv);
+
+    printf("engine %d: score %d, %lu nodes, pv %s: %s\n", i,
+	   together[i].score, together[i].nodes, together[i].pv,
+	   same ? "ok" : "DIFFERS");
+    if (!same) {
+      printf("  alone: score %d, %lu nodes, pv %s\n",
+	     alone[i].score, alone[i].nodes, alone[i].pv);
+      failed++;
+    }
+  }
+
+  for (i = 0; i < ENGINES; i++)
+    gully_delete(g[i]);
+
+  return failed ? 1 : 0;
+}
@@ -82,6 +82,20 @@ init_hash(void)
 	}
 }
 
+unsigned int
+hash_keys_fingerprint(void)
+{
+  int i,j,k;
+  unsigned int f = 0;
+
+  for(k=0;k<2;k++)
+    for(j=0;j<6;j++)
+      for(i=0;i<128;i++)
+	f = (f * 31) ^ hash_array64[k][j][i].part_one 
+	  ^ (hash_array64[k][j][i].part_two >> 7);
+  return f;
+}
+
 /*
   sets hashed_position according to current board position 
   and turn (used for initialization).
@@ -187,6 +201,68 @@ update_hash(position_hash_t * h, const move_t * m)
     }
 }
 
+/* 
+ * Same as make_move() does for a normal move, but the move is not
+ * made: the piece is still on the from square. Enhanced transposition
+ * cutoffs in search() use this to probe the children. Moves which
+ * need more than update_hash() are left out.
+ */
+int
+child_hash(position_hash_t * h, const move_t * m, int ply)
+{
+  int color_index = (turn == WHITE) ? 0 : 1;
+  int from = GET_FROM(m->from_to), to = GET_TO(m->from_to);
+  piece_t piece;
+
+  if (m->special != NORMAL_MOVE || GET_PRO(m->cap_pro))
+    return 0;
+
+  piece = GET_PIECE(*BOARD[from]);
+  if (move_flags[ply].castling_flags 
+      && (piece == KING || piece == ROOK || GET_CAP(m->cap_pro) == ROOK))
+    return 0;
+
+  *h = move_flags[ply].hash;
+  if (move_flags[ply].e_p_square)
+    XOR64(*h, EP_HASHVAL(move_flags[ply].e_p_square));
+
+  XOR64(*h, ALTER_TURN);
+  XOR64(*h, hash_array64[color_index][piece-1][from]);
+  XOR64(*h, hash_array64[color_index][piece-1][to]);
+
+  if (m->cap_pro)
+    XOR64(*h, hash_array64[color_index^1][GET_CAP(m->cap_pro)-1][to]);
+
+  return 1;
+}
+
+int
+child_pawn_hash(position_hash_t * h, const move_t * m, int ply)
+{
+  int color_index = (turn == WHITE) ? 0 : 1;
+  int from = GET_FROM(m->from_to), to = GET_TO(m->from_to);
+  int pawn_moved, pawn_taken;
+
+  if ((m->special != NORMAL_MOVE && m->special != DOUBLE_ADVANCE)
+      || GET_PRO(m->cap_pro))
+    return 0;
+
+  pawn_moved = (GET_PIECE(*BOARD[from]) == PAWN);
+  pawn_taken = (GET_CAP(m->cap_pro) == PAWN);
+  if (!pawn_moved && !pawn_taken)
+    return 0;
+
+  *h = move_flags[ply].phash;
+  if (pawn_moved) {
+    XOR64(*h, hash_array64[color_index][PAWN-1][from]);
+    XOR64(*h, hash_array64[color_index][PAWN-1][to]);
+  }
+  if (pawn_taken)
+    XOR64(*h, hash_array64[color_index^1][PAWN-1][to]);
+
+  return 1;
+}
+
 /* ep_square has changed */
 void 
 update_hash_epsq(position_hash_t * h, const square_t epsq)
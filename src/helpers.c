@@ -1,5 +1,9 @@
 /* $Id: helpers.c,v 1.30 2011-03-05 20:42:15 martin Exp $ */
 
+#if defined (UNIX)
+#define _POSIX_C_SOURCE 200112L /* strtok_r */
+#endif
+
 #include <assert.h>
 #include <string.h>
 #include <ctype.h>
@@ -25,11 +29,11 @@ static void strip_buf(const char *src, char *dest);
 int
 solution_correct(char *buf)
 {
-  char *token;
+  char *token, *save = NULL;
   char stripped_buf[12]; 
   move_t parsed_move, pv_move;
 
-  if((token = strtok(buf, " ")) == NULL) return 0;
+  if((token = STRTOK_R(buf, " ", &save)) == NULL) return 0;
 
   if(strncmp(buf, "none", 4) == 0) return 0;
 
@@ -47,7 +51,7 @@ solution_correct(char *buf)
 	&& parsed_move.cap_pro == pv_move.cap_pro)
       return 1;
   }
-  while ((token = strtok(NULL, " ")) != NULL );
+  while ((token = STRTOK_R(NULL, " ", &save)) != NULL );
       
   return 0;
 }
@@ -75,6 +79,7 @@ clear_move_list(int index1,int index2)
 
   if (index2 == index1) return;
   memset((char*) & (move_array[index1]), 0, (index2-index1) * sizeof(move_t));
+  memset((char*) & (move_key[index1]), 0, (index2-index1) * sizeof(int));
 }
 
 
@@ -245,16 +250,14 @@ update_material_on_promotion(piece_t pro_p, piece_t cap_p)
 /*
  * As in crafty, looking which game phase we are in is done
  * just once per call to iterate().
- * Its responsibility is also to allow null moves or not.
+ * Null moves are no longer switched off here, search() decides per
+ * node (see NULL_MATERIAL_OK).
  * The decisions of phase() are based on the root position (before
  * search is done).
  *
  * XXX : This function is currently used to let the eval decide which
  * evalution should be applied. This is too simplistic.
  *
- * phase() is useful for search configuration (null moves), but not
- * much more.
- *
  * XXX Decision which eval routine will be used should be based on
  * info from mat_dist_table!
  */
@@ -263,13 +266,6 @@ void
 phase(void)
 {
   int wpi_mat,wpa_mat,bpi_mat,bpa_mat;
-  static int user_nulloption = -1;
-
-  /* save default or command line null setting */
-  if (user_nulloption == -1) { 
-    user_nulloption = NULL_ON;
-    log_msg("phase: init user_nulloption == %d.\n", user_nulloption);
-  }
 
   wpa_mat = GET_PAWN_MATERIAL(move_flags[0].w_material);
   bpa_mat = GET_PAWN_MATERIAL(move_flags[0].b_material);
@@ -277,8 +273,6 @@ phase(void)
   wpi_mat = get_piece_material(move_flags[0].w_material);
   bpi_mat = get_piece_material(move_flags[0].b_material);
 
-  if (user_nulloption) SET_OPTION(O_NULL_BIT);
-  
   /* 
    *  what game phase is it 
    * FIXME: hardcoded material limit.
@@ -289,13 +283,6 @@ phase(void)
     if ((wpa_mat == 0) && (bpa_mat == 0))
       game_phase = PAWNLESS;
     
-    /* sometimes null move is better disabled. 
-       However, there is no easy way to re-set
-       the option. See top.
-    */
-    if ((wpi_mat < 1000) && (bpi_mat < 1000))
-      RESET_OPTION(O_NULL_BIT);
-    
     return;
   }
   
@@ -320,12 +307,27 @@ print_usage(char * progname)
 	"--book {on,off,<book_file_name>}\n"
 	"-t | --test {solve,see,eval,search,movegen,make} \n"
 	"\tIn conjunction with file.\n" 
+	"-t | --test check            \t\tSelf check, no file needed.\n"
 	"--bench                      \t\tSome standard numbers\n"
 	"--maxdepth <max_dep>         \t\tMax. full width "
 	"search depth.\n"
 	"--time <max_time>         \t\ttime per move in [1/10s]\n\n"
 	"--nokiller                  \t\t Killers off.\n"
-	"--transref <size>         \tmain size 2exp(size), 0 == off\n"	
+	"--hash <MB>               \tmain hash table size, 0 == off\n"
+	"--transref <size>         \tsame in 2exp(size) * 16 bytes\n"	
+	"--hashfile <file>         \tstart with a saved hash table\n"
+	"--hashshm <name>          \tshare the hash table between processes\n"
+	"--threads <n>             \tsearch with n threads\n"
+	"--nopvs                   \tfull window for all moves\n"
+	"--lmr <moves>[,<depth>]   \treduce late quiet moves, 0 == off\n"
+	"--nofutility --norazor --nolmp \tno pruning near the leaves\n"
+	"--noqchecks               \tno quiet checks in quiescence\n"
+	"--iid <depth>             \tfind a hash move from depth, 0 == off\n"
+	"--singular <depth>        \textend singular hash moves, 0 == off\n"
+	"--probcut <margin>[,<reduction>] \tcut by shallow captures, 0 == off\n"
+	"--ext <check>[,<recapture>[,<pawn>[,<single>]]]\n"
+	"                          \textensions in quarter plies, 0-4 each\n"
+	"--searchmoves <e2e4,...>  \tsearch only these root moves\n"
 	"(options may be abbreviated as long as uniquely "
 	"identified)\n",
 	progname);
@@ -435,6 +437,7 @@ command_help(int command)
 	   "easy [Permanent brain OFF]\n"
 	   "hard [Permanent brain ON ]\n"
 	   "hash [Toggle transposition table usage]\n"
+	   "hash save <file> | load <file> | clear [Table snapshots]\n"
 	   "reverse\n"
 	   "book [admin | on | off | status | <book_file>]\n"
 	   "remove [Take back one full move]\n"
@@ -452,7 +455,8 @@ command_help(int command)
 	   "time [Set computers remaining time in 1/100 s]\n"
 	   "level [Set game time format, e.g. level 0 5 0]\n"
 	   "ponder [Toggle permanent brain usage]\n"
-	   "setup [Set position up from FEN or EPD String]\n");
+	   "setup [Set position up from FEN or EPD String]\n"
+	   "cores [Number of search threads]\n");
   else
     printf("No help available for command\n");
   
@@ -7,6 +7,11 @@
    Also, the killer table is initialized with the PV from the last ply
    which seems smart to me (?) XXX:Crafty keeps the PV in the transposition
    table which looks even better.
+
+   Moves causing a cutoff are also rewarded in the history tables
+   (quiet moves and captures separately, depth^2 each time) and become
+   the counter move to the move played before. See order.c for their
+   use.
    */
 
 #include <string.h>
@@ -15,8 +20,15 @@
 #include "chess.h"
 #include "history.h"
 #include "chessio.h"
+#include "movegen.h" /* GET_FROM */
+
+THREAD_LOCAL struct killer_struct_tag Killer[MAX_KILLER_PLY][2];
+THREAD_LOCAL int History[2][128][128];
+THREAD_LOCAL int CounterMove[2][128][128];
+THREAD_LOCAL int CaptureHistory[2][7][128][7];
+THREAD_LOCAL int line_moves[MAX_KILLER_PLY];
 
-struct killer_struct_tag Killer[MAX_KILLER_PLY][2];
+static void halve_history(int side);
 
 void 
 reset_killers(void)
@@ -96,5 +108,87 @@ pv_2_killer()
     }
 }
 
+void
+reset_history(void)
+{
+  memset((void*) &History, 0, sizeof(History));
+  memset((void*) &CounterMove, 0, sizeof(CounterMove));
+  memset((void*) &CaptureHistory, 0, sizeof(CaptureHistory));
+  memset((void*) &line_moves, 0, sizeof(line_moves));
+}
+
+static void
+halve_history(int side)
+{
+  int *h, *end;
+
+  for(h = &History[side][0][0], end = h + 128 * 128; h < end; h++)
+    *h >>= 1;
+  for(h = &CaptureHistory[side][0][0][0], end = h + 7 * 128 * 7; 
+      h < end; h++)
+    *h >>= 1;
+}
+
+/* 
+   Called before each iteration: older results count less, the
+   counter moves stay.
+   */
+
+void
+age_history(void)
+{
+  halve_history(0);
+  halve_history(1);
+}
+
+/*
+  m caused a cutoff at the current ply with n plies remaining. Has to 
+  be called with the move undone.
+  */
+
+void
+update_history(const move_t *m, int n)
+{
+  int side = HISTORY_SIDE(turn), bonus = n * n + 1, *h;
+  square_t from = GET_FROM(m->from_to), to = GET_TO(m->from_to);
+
+  assert(current_ply < MAX_KILLER_PLY);
+
+  if(m->cap_pro)
+    {
+      if(!GET_CAP(m->cap_pro))
+	return; /* plain promotion */
+      h = &CaptureHistory[side][GET_PIECE(*BOARD[from])][to]
+	[GET_CAP(m->cap_pro)];
+    }
+  else
+    {
+      h = &History[side][from][to];
+
+      if(current_ply && line_moves[current_ply - 1])
+	{
+	  int prev = line_moves[current_ply - 1];
+	  CounterMove[side][GET_FROM(prev)][GET_TO(prev)] = m->from_to;
+	}
+    }
+
+  *h += bonus;
+  if(*h > HISTORY_MAX)
+    halve_history(side);
+}
+
+/* the counter move for the move leading to the current ply, or 0 */
+
+int
+counter_move(void)
+{
+  int prev;
+
+  if(!current_ply || !(prev = line_moves[current_ply - 1]))
+    return 0;
+
+  return CounterMove[HISTORY_SIDE(turn)][GET_FROM(prev)][GET_TO(prev)];
+}
+
 
 
@@ -1,5 +1,9 @@
 /* $Id: init.c,v 1.43 2011-03-05 20:45:07 martin Exp $ */
 
+#if defined (UNIX)
+#define _POSIX_C_SOURCE 200112L /* strtok_r */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h> /* calloc */
 #include <string.h>
@@ -21,6 +25,7 @@
 #include "chessio.h" /* piece_name */
 #include "transref.h" /* clear tt table */
 #include "history.h" /* clear killers */
+#include "search.h" /* DEFAULT_LMR_* */
 #include "version.h"
 
 #ifndef NULL
@@ -28,7 +33,7 @@
 #endif
 
 /* space for testpositions */
-static struct epd_buf_tag {
+static THREAD_LOCAL struct epd_buf_tag {
   char fen_buf[128]; /*  forsythe-edwards like position description */
   char turn; /* either 'b'  or 'w' */
   char castling[5]; /* contains string like 'KQkq' or just '-' */
@@ -82,9 +87,22 @@ reset_gameoptions(void)
   gameopt.maxdepth = MAX_SEARCH_DEPTH >> 1;
   gameopt.test = CMD_TEST_NONE;
   gameopt.testfile[0] = '\0';
-  gameopt.transref_size = DEFAULT_TT_BITS;
+  gameopt.searchmoves[0] = 0;
+  gameopt.transref_size = DEFAULT_TT_MB;
+  gameopt.threads = 1;
+  gameopt.lmr_moves = DEFAULT_LMR_MOVES;
+  gameopt.lmr_depth = DEFAULT_LMR_DEPTH;
+  gameopt.iid_depth = DEFAULT_IID_DEPTH;
+  gameopt.singular_depth = DEFAULT_SINGULAR_DEPTH;
+  gameopt.ext_check = DEFAULT_EXT_CHECK;
+  gameopt.ext_recapture = DEFAULT_EXT_RECAPTURE;
+  gameopt.ext_pawn = DEFAULT_EXT_PAWN;
+  gameopt.ext_single = DEFAULT_EXT_SINGLE;
+  gameopt.probcut_margin = DEFAULT_PROBCUT_MARGIN;
+  gameopt.probcut_reduction = DEFAULT_PROBCUT_REDUCTION;
   gameopt.options = O_TRANSREF_BIT | O_KILLER_BIT | O_POST_BIT 
-    | O_PONDER_BIT | O_NULL_BIT | O_BOOK_BIT;
+    | O_PONDER_BIT | O_NULL_BIT | O_BOOK_BIT | O_PVS_BIT 
+    | O_FUTILITY_BIT | O_RAZOR_BIT | O_LMP_BIT | O_QCHECKS_BIT;
 }
 
 #define NALLOC 80
@@ -151,13 +169,28 @@ extend_the_game(struct the_game_tag **game)
 
 int
 setup_board(char * epd_buf)
+{
+  if (!setup_position(epd_buf))
+    err_quit("SetUpBoard failed\n");
+  return 1;
+}
+
+/* 
+ * Like setup_board, but returns 0 if epd_buf cannot be parsed 
+ * instead of exiting. The board is then undefined.
+ */
+int
+setup_position(char * epd_buf)
 {
   clear_move_flags();
   reset_board_and_plist();
-  /* special handling for fritz / chessbase, see reset command */
-  if(!FRITZ_ON) tt_clear();
-  if(!FRITZ_ON) ph_clear();
+  /* special handling for fritz / chessbase, see reset command.
+     Library users clear explicitly, see gully_clear_hash(). A loaded
+     snapshot is kept until "hash clear". */
+  if(!FRITZ_ON && !EMBEDDED_ON && !tt_keep_on_setup) tt_clear();
+  if(!FRITZ_ON && !EMBEDDED_ON) ph_clear();
   reset_killers();
+  reset_history();
   clear_move_list(0, MAX_MOVE_ARRAY);
   clear_pv(0);
 
@@ -174,11 +207,11 @@ setup_board(char * epd_buf)
     strcpy(default_buf,"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR"
 	   " w KQkq - bm e4; id start;"); 
     if (!setup_from_epd(default_buf))
-      err_quit("SetUpBoard failed\n");
+      return 0;
   }
   else
     if (!setup_from_epd(epd_buf))
-      err_quit("SetUpBoard failed\n");
+      return 0;
 
   /* initialize material score */
   assert(current_ply == 0 && (turn == WHITE || turn == BLACK));
@@ -274,7 +307,7 @@ setup_from_epd(char *buf)
 {
   int i,state = 100;
   const char delimiters[] = " ;\n";
-  char *token;
+  char *token, *save = NULL;
   int irr_plies,move_cnt;
 
   if(!buf) return 0;
@@ -310,7 +343,7 @@ setup_from_epd(char *buf)
   strcpy(epd_buf.id, "none");
   
   /* tokenize remaining buffer - first skip over the mandatory fields */
-  token = strtok(buf, delimiters);
+  token = STRTOK_R(buf, delimiters, &save);
   
   if((token == NULL) || !i) {
     err_msg("empty buf? %s\n",buf);
@@ -320,32 +353,32 @@ setup_from_epd(char *buf)
     while(--i) {
       if(!state)
 	break;
-      token = strtok(NULL, delimiters);
+      token = STRTOK_R(NULL, delimiters, &save);
       if(token == NULL)
 	state = 0;
     }
   }
 
-  while(state &&  ((token = strtok(NULL, delimiters)) != NULL)) {
+  while(state &&  ((token = STRTOK_R(NULL, delimiters, &save)) != NULL)) {
     unsigned long j;
     
     if(!strcmp(token,"bm")) {
       state = 1;
-      token = strtok(NULL,";");
+      token = STRTOK_R(NULL, ";", &save);
       if(token)
 	strncpy(epd_buf.bm, token, TESTPOS_SOL_LENGTH);
       continue;
     }
     if(!strcmp(token,"am")) {
       state = 1;
-      token = strtok(NULL,";");
+      token = STRTOK_R(NULL, ";", &save);
       if(token)
 	strncpy(epd_buf.am, token, TESTPOS_SOL_LENGTH);
       continue;
     }
     if(!strcmp(token,"id")) {
       state = 2;
-      token = strtok(NULL,";");
+      token = STRTOK_R(NULL, ";", &save);
       if(token)
 	strncpy(epd_buf.id, token, TESTPOS_ID_LENGTH);
       continue;
@@ -371,8 +404,10 @@ setup_from_epd(char *buf)
 
   /* setup board */
   if(!setup_from_fen_string(epd_buf.fen_buf, epd_buf.turn,
-			    epd_buf.castling, epd_buf.ep_square))
-    err_quit("setup_from_fen");
+			    epd_buf.castling, epd_buf.ep_square)) {
+    err_msg("setup_from_fen");
+    return 0;
+  }
 
   /* moves since last irreversible move - XXX should take info from
      epd file */
@@ -30,6 +30,7 @@
 #include "analyse.h"
 #include "version.h"
 #include "transref.h" /* tt_clear */
+#include "smp.h" /* MAX_THREADS */
 
 #define INPUT_MAXSIZE 128
 
@@ -49,7 +50,7 @@ static int command_error_reason;
    Must match constants defined in input.h
  */
 
-#define MAX_COMMANDS 58 /* members in cmds[] */
+#define MAX_COMMANDS 59 /* members in cmds[] */
 
 char * cmds[] =
 {
@@ -110,7 +111,8 @@ char * cmds[] =
   "protover",
   "accepted",
   "rejected",
-  "reset"
+  "reset",
+  "cores"
 };
 
 
@@ -786,7 +788,11 @@ do_command(int command, char * cmd_buf)
    */
 
   switch (command) {
-  case GNU_CMD_HASH:
+  case GNU_CMD_HASH: {
+    /* hash [save <file> | load <file> | clear] */
+    char option_buf[16], file_buf[256];
+
+    option_buf[0] = file_buf[0] = '\0';
     if (! IS_IDLE) return EX_CMD_BUSY;
     /* initial hash size cannot be changed */
     if (gameopt.transref_size == 0) {
@@ -796,10 +802,28 @@ do_command(int command, char * cmd_buf)
       command_error_reason = G2_NOTLEGALNOW_CMD;
       break;
     }
-    TOGGLE_OPTION(O_TRANSREF_BIT);
-    log_msg("do_command: toggled transref bit, now %s.\n",
-	    (TRANSREF_ON) ? "ON" : "OFF");
+    sscanf(cmd_buf, "%*s %15s %255s", option_buf, file_buf);
+    if (strlen(option_buf) < 1) {
+      TOGGLE_OPTION(O_TRANSREF_BIT);
+      log_msg("do_command: toggled transref bit, now %s.\n",
+	      (TRANSREF_ON) ? "ON" : "OFF");
+    }
+    else if (!strcmp(option_buf, "clear")) {
+      tt_keep_on_setup = 0;
+      tt_clear();
+    }
+    else if ((strcmp(option_buf, "save") && strcmp(option_buf, "load"))
+	     || strlen(file_buf) < 1) {
+      errorflag = 1;
+      command_error_reason = G2_NUMPARAM_CMD;
+    }
+    else if ((option_buf[0] == 's') ? 
+	     tt_save(file_buf) : tt_load(file_buf)) {
+      errorflag = 1;
+      command_error_reason = G2_FAILED_CMD;
+    }
     break;
+  }
   case GNU_CMD_O_O:
   case GNU_CMD_O_O_O:
     /* should be handled by move parser */
@@ -1175,7 +1199,7 @@ do_command(int command, char * cmd_buf)
       sscanf(cmd_buf, "%*s %d", &prot_version);
       log_msg("Xboard protocol version %d.\n", prot_version);
       if(prot_version >= 2) { /* XXX experimental */
-	fprintf(stdout, "feature done=0 ping=1 setboard=1 name=1\n");
+	fprintf(stdout, "feature done=0 ping=1 setboard=1 name=1 smp=1\n");
 	fprintf(stdout, "feature myname=\"%s\" done=1\n", the_game->my_name);
       }      
     }
@@ -1184,6 +1208,16 @@ do_command(int command, char * cmd_buf)
   case XB_CMD_REJECTED:
     log_msg("No action taken: %s", cmd_buf);
     break;
+  case XB_CMD_CORES:
+    /* number of search threads, used from the next search on */
+    {
+      int cores = 1;
+
+      sscanf(cmd_buf, "%*s %d", &cores);
+      gameopt.threads = MIN(MAX(cores, 1), MAX_THREADS);
+      log_msg("Search threads: %d\n", gameopt.threads);
+    }
+    break;
   case GULLY_CMD_RESET:
     /* ignore if not fritz */
     if(! FRITZ_ON) {
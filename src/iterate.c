@@ -11,7 +11,7 @@
 #include "mstimer.h"
 #include "test.h"
 #include "search.h"
-#include "history.h" /* pv_2_killer */
+#include "history.h" /* pv_2_killer, age_history */
 #include "iterate.h"
 #include "execute.h"
 #include "input.h" /* do_command */
@@ -19,19 +19,37 @@
 #include "logger.h"
 #include "helpers.h" /* phase */
 #include "init.h" /* reset_game_stats */
+#include "smp.h"
+#include "order.h" /* root move list */
+#include "transref.h" /* tt_new_search, tt_hashfull */
 
-struct iterate_stats_tag iterate_stats;
+THREAD_LOCAL struct iterate_stats_tag iterate_stats;
+
+static int pv_length(void);
+
+/* number of moves in the principal variation */
+static int
+pv_length(void)
+{
+  int i = 0;
+
+  while(i < MAX_SEARCH_DEPTH && principal_variation[0][i].from_to)
+    i++;
+  return i;
+}
 
 int
 iterate(int depth,enum global_search_state_tag g_state,
 	struct pos_solve_stat_tag *pss)
 {
   int i = 1,score = 0,last_score = 0;
+  int lower, upper, delta, share, last_best = 0;
   move_t saved_move;
   enum local_search_state_tag { 
     REGULAR_SEARCH, FAIL_HIGH_SEARCH, FAIL_LOW_SEARCH } local_search_state; 
 
   iterate_stats.max_depth_reached = 0;
+  iterate_stats.fail_lows = iterate_stats.fail_highs = 0;
 
   global_search_state = g_state;
   abort_search = 0;
@@ -43,31 +61,73 @@ iterate(int depth,enum global_search_state_tag g_state,
      such as seeing which game phase we are in etc. */
   
   phase();
+  init_root_moves();
+  tt_new_search();
+
+  /* helpers search the same root, sharing the ttable */
+  smp_start(depth);
 
   while(i <= depth) {
     local_search_state = REGULAR_SEARCH;
+    iterate_stats.ply_fail_lows = iterate_stats.ply_fail_highs = 0;
     
     if(KILLERS_ON && !TRANSREF_ON)
       pv_2_killer();
+    age_history();
     
-    score = search(last_score - WINDOW,last_score + WINDOW,i,0);
-    if(!abort_search) {
-      if(score <= last_score - WINDOW) {
+    /* 
+     * Aspiration window around the last score. The bound that fails
+     * is widened stepwise until the score fits. Mate scores are 
+     * searched with an open window.
+     */
+    delta = WINDOW;
+    lower = ASPIRATION_LOWER(last_score - delta, delta);
+    upper = ASPIRATION_UPPER(last_score + delta, delta);
+    if (IS_MATE_SCORE(last_score)) {
+      lower = -INFINITY;
+      upper = INFINITY;
+    }
+
+    while(1) {
+      score = search(lower, upper, i, 0);
+      if(abort_search)
+	break;
+      /* the best move so far first, then by effort */
+      sort_root_moves(principal_variation[0][0].from_to);
+
+      if(score <= lower && lower > -INFINITY) {
 	fpost(stdout, i, FAIL_LOW, score,
 	      (float) time_diff(get_time(), game_time.timestamp));
+	iterate_stats.fail_lows++;
+	iterate_stats.ply_fail_lows++;
+	/* keep the move of the last iteration in case we run out of time */
+	if(local_search_state != FAIL_LOW_SEARCH)
+	  memcpy((void *) &saved_move, &principal_variation[0][0],
+		 sizeof(saved_move));
 	local_search_state = FAIL_LOW_SEARCH;
-	memcpy((void *) &saved_move, &principal_variation[0][0],
-	       sizeof(saved_move));
-	score = search( -INFINITY,last_score - WINDOW,i,0);
+	upper = (lower + upper) / 2;
+	lower = ASPIRATION_LOWER(lower - delta, 2 * delta);
       }
-      else if(score >= last_score + WINDOW) {
+      else if(score >= upper && upper < INFINITY) {
 	fpost(stdout, i, FAIL_HIGH, score,
 	      (float) time_diff(get_time(), game_time.timestamp));
+	iterate_stats.fail_highs++;
+	iterate_stats.ply_fail_highs++;
 	local_search_state = FAIL_HIGH_SEARCH;
-	score = search( last_score + WINDOW,INFINITY,i,0);
+	upper = ASPIRATION_UPPER(upper + delta, 2 * delta);
       }
-      if(abort_search)
-	goto abort;
+      else 
+	break;
+
+      delta += delta;
+    }
+
+    if(!abort_search) {
+      share = root_move_share();
+      log_msg("iterate: ply %d: %d fail lows, %d fail highs, best move "
+	      "%d%% of the nodes (%.2f s)\n", 
+	      i, iterate_stats.ply_fail_lows, iterate_stats.ply_fail_highs,
+	      share, (float) time_diff(get_time(), game_time.timestamp));
 
       fpost(stdout, i, PLY_COMPLETE, score,
 	    (float) time_diff(get_time(), game_time.timestamp));
@@ -79,15 +139,43 @@ iterate(int depth,enum global_search_state_tag g_state,
 	update_pss(pss, i-1, &principal_variation[0][0],
 		   (float) time_diff(get_time(), game_time.timestamp));
       }
-      
+
+      /* 
+       * Stop on a mate (D. Corbit, see BUGS): the score is exact, the
+       * PV plays it out and the search went MATE_STOP_MARGIN plies
+       * beyond it. Pruning and reductions make this a heuristic, a
+       * shorter mate or a defence may still be found deeper.
+       * Pondering and analysis go on, the position may change.
+       */
+      if(IS_SEARCHING && IS_MATE_SCORE(score) 
+	 && pv_length() == MATE_DISTANCE(score)
+	 && i >= MATE_DISTANCE(score) + MATE_STOP_MARGIN) {
+	log_msg("iterate: ply %d: mate in %d plies found, stopping.\n",
+		i, MATE_DISTANCE(score));
+	break;
+      }
+
+      /* 
+       * Easy move: on the clock, a best move which stays the same and
+       * takes nearly all of the nodes is not going to change in the
+       * next iteration, so the rest of the time is saved.
+       */
+      if(IS_SEARCHING && game_time.use_game_time && i >= EASY_MOVE_DEPTH
+	 && principal_variation[0][0].from_to == last_best
+	 && share >= EASY_MOVE_SHARE
+	 && (get_time() - game_time.timestamp) * EASY_MOVE_TIME_DIVISOR
+	 >= game_time.time_allocated) {
+	log_msg("iterate: ply %d: easy move, stopping.\n", i);
+	break;
+      }
+      last_best = principal_variation[0][0].from_to;
     }
 
     else {
-    abort:
 
       switch(local_search_state) {
       case FAIL_LOW_SEARCH:
-	printf("using saved move instead\n");
+	if (!EMBEDDED_ON) printf("using saved move instead\n");
 	memcpy((void*) &principal_variation[0][0],
 	       (void*) &saved_move, sizeof(saved_move));
 	memset((void*)&principal_variation[0][1], 0,
@@ -125,6 +213,9 @@ iterate(int depth,enum global_search_state_tag g_state,
     i++;
   }
 
+  smp_stop();
+  log_msg("iterate: hash %d permille full.\n", tt_hashfull());
+
   /* check for reaching the maximum search depth. This means the either
      mate, stalemate, draw (by repetition or not sufficient material)
   */
@@ -78,7 +78,21 @@ main(int argc, char** argv)
   init_hash();
 
   if (gameopt.transref_size) {
-    if ((init_transref_table(gameopt.transref_size)) == -1)
+    /* 
+     * A shared table comes first, its entries are not overwritten
+     * by a snapshot ("hash load" does that). A snapshot or segment
+     * which does not fit gives way to a new table.
+     */
+    if (tt_shared_name != NULL) {
+      if (tt_snapshot_file != NULL)
+	log_msg("main.c: shared hash table, ignoring %s.\n", 
+		tt_snapshot_file);
+      if (tt_share(tt_shared_name, gameopt.transref_size) == -1
+	  && (init_transref_table(gameopt.transref_size)) == -1)
+	return -1;
+    }
+    else if ((tt_snapshot_file == NULL || tt_map(tt_snapshot_file) == -1)
+	     && (init_transref_table(gameopt.transref_size)) == -1)
       return -1;
   } else log_msg("main.c: Skipping initialization of main hash table.\n");
     
@@ -91,8 +105,7 @@ main(int argc, char** argv)
   /* test file read skips interaction */
   if (gameopt.test != CMD_TEST_NONE) {
     /* facade for bench cmd and several tests */
-    do_test();
-    return 0;
+    return do_test();
   }
 
   /* setup game history */
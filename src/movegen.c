@@ -6,6 +6,8 @@
 #include "movegen.h"
 #include "logger.h"
 #include "chessio.h"
+#include "attacks.h"
+#include "helpers.h" /* clear_move_list */
 
 /* -------- Macros for inserting moves into the move list ------------ */
 
@@ -114,7 +116,7 @@ void generate_castling(const int ctm,int * index,
    This will be packed if necessary at the root or extended for
    promotions
 */
-int MaxWhitePiece=7,MaxWhitePawn=23,MaxBlackPiece=39,MaxBlackPawn=55;
+THREAD_LOCAL int MaxWhitePiece=7,MaxWhitePawn=23,MaxBlackPiece=39,MaxBlackPawn=55;
 
 /*
 Generate all moves for side color.
@@ -519,6 +521,93 @@ generate_captures(const int ColorToMove,int index)
 
 }
 
+/*
+ * Check evasions for side ColorToMove, which has to be in check:
+ * king moves and, against a single checker, captures of the checking
+ * piece and interpositions. Like generate_moves(), the moves are only
+ * pseudo legal.
+ */
+int
+generate_evasions(const int ColorToMove,int index)
+{
+  square_t ksq = (ColorToMove == WHITE) ? 
+    move_flags[current_ply].white_king_square :
+    move_flags[current_ply].black_king_square;
+  square_t checker = 0;
+  int checkers, i, last, new_index;
+
+  checkers = attackers(ColorToMove ^ 32, ksq, &checker);
+  assert(checkers);
+
+  new_index = generate_moves(ColorToMove, index);
+
+  /* squeeze out the moves which leave the check alone */
+  for(i = last = index; i < new_index; i++)
+    {
+      square_t from = GET_FROM(move_array[i].from_to);
+      square_t to = GET_TO(move_array[i].from_to);
+
+      if(move_array[i].special == CASTLING)
+	continue;
+      if(from != ksq)
+	{
+	  if(checkers > 1)
+	    continue;
+	  /* a checking pawn can only be the one which just moved */
+	  if(to != checker && !between(ksq, checker, to)
+	     && !(move_array[i].special == EN_PASSANT 
+		  && GET_PIECE(*BOARD[checker]) == PAWN))
+	    continue;
+	}
+      if(i != last)
+	move_array[last] = move_array[i];
+      last++;
+    }
+
+  clear_move_list(last, new_index);
+  return last;
+}
+
+/*
+ * Is from_to a pseudo legal move for side ColorToMove? Hash moves and
+ * killers may stem from other positions. If so, the move is written
+ * to move_array[index] (the queen promotion for promotions) and 1
+ * is returned.
+ */
+int
+generate_move(const int ColorToMove,int from_to,int index)
+{
+  square_t from = GET_FROM(from_to), to = GET_TO(from_to);
+  int i, end, found;
+
+  if((from & 0x88) || (to & 0x88) || from == to 
+     || BOARD[from] == BOARD_NO_ENTRY
+     || (PLIST_OFFSET(BOARD[from]) & BLACK) != ColorToMove)
+    return 0;
+
+  /* generate the moves of the piece on from and look for to */
+  if(GET_PIECE(*BOARD[from]) == PAWN)
+    {
+      end = generate_pawn_move(ColorToMove, index, from);
+      if(move_flags[current_ply].e_p_square & 0x70)
+	generate_e_p(ColorToMove, &end, move_flags[current_ply].e_p_square);
+    }
+  else
+    end = generate_piece_move(ColorToMove, index, GET_PIECE(*BOARD[from]), 
+			      from);
+
+  for(i = index; i < end; i++)
+    if(move_array[i].from_to == from_to)
+      break;
+
+  found = (i < end);
+  if(found && i != index)
+    move_array[index] = move_array[i];
+
+  clear_move_list(index + found, end);
+  return found;
+}
+
 /* generates captures for piece on square sq.
    moves will be written to movelist starting at index.
    returns lowest unused free spot in movelist
@@ -27,7 +27,7 @@
 #endif
 
 /* all time related information */
-struct game_time_tag game_time;
+THREAD_LOCAL struct game_time_tag game_time;
 
 void
 init_game_time()
@@ -36,6 +36,7 @@ init_game_time()
     game_time.time_per_move = DEFAULT_TIME_PER_MOVE;
 
   game_time.next_check = 0;
+  game_time.check_nodes = NODES_BETWEEN_TIME_CHECK;
   game_time.timestamp = 0;
   game_time.stop_time = 0;
   game_time.time_allocated = 0;
@@ -95,8 +96,9 @@ get_time(void)
 #ifdef UNIX
   struct tms t;
   
-  (void) times(&t);
-  return (t.tms_utime + t.tms_stime);
+  /* elapsed (wall clock) time: the process cpu time grows with the
+     number of search threads */
+  return (unsigned long) times(&t);
 
 #elif defined (WIN32)
   struct _timeb time_buf;
@@ -11,78 +11,58 @@
 #include "history.h"
 #include "execute.h"
 #include "quies.h"
+#include "search.h" /* pick */
+#include "helpers.h" /* clear_move_list */
+#include "transref.h" /* tt_retrieve */
+
+THREAD_LOCAL struct root_list_tag root_list;
 
 #define KILLER_BONUS 80
+#define COUNTER_BONUS 70
 #define TRANSREF_BONUS 2000 /* should be largest bonus */
 
-/*
-  move ordering function to be used in regular search.
-  It is called at maximum once per search() call.
+/* quiet moves come after killers and captures, in history order */
+#define HISTORY_KEY(h) ((h) * 999 / HISTORY_MAX - 1000)
+/* breaks ties between captures of the same value */
+#define CAPTURE_HISTORY_KEY(m) \
+  (CaptureHistory[HISTORY_SIDE(turn)][GET_PIECE(*BOARD[GET_FROM((m)->from_to)])]\
+   [GET_TO((m)->from_to)][GET_CAP((m)->cap_pro)] * 19 / HISTORY_MAX)
 
-  Awards bonus for 
-  a) being move from the transposition table
-  b) be a winning capture
-  c) be a killer
-  d) even capture
-  e) rest ... normally no bonus.
- 
-  moves are in move_array[index..end_index].
+static int quiet_key(const move_t *m, int counter);
 
-  If tt_from_to is != 0 it will be tried as first key.
+/* MVV-LVA keys in the picker's capture stage, indexed by piece */
+static const int mvv_lva_value[7] = { 0, 0, 9, 5, 3, 3, 1 };
+#define MVV_LVA_KEY(m) \
+  (64 * (mvv_lva_value[GET_CAP((m)->cap_pro)]			\
+	 + mvv_lva_value[GET_PRO((m)->cap_pro)])			\
+   - 4 * mvv_lva_value[GET_PIECE(*BOARD[GET_FROM((m)->from_to)])]	\
+   + CAPTURE_HISTORY_KEY(m) / 5)
 
-  n is the search depth remaining, e.g. killers are only taken care
-  of in basic search.
+/* captures put back by see() for the PICK_LOSING stage */
+#define LOSING_KEY -2000
 
-  */
+static int same_move(const move_t *a, const move_t *b);
+static int is_refutation(const struct move_picker_tag *mp, int from_to);
 
-int
-order_moves(int index, int end_index, int tt_from_to, int n)
+void
+order_captures(int index, int end_index, int tt_from_to)
 {
   int i;
-  
-  if(n && KILLERS_ON)
-    /* reset killers for NEXT ply */
-    reset_killer_use_count(current_ply+1);
 
-  for (i = index; i < end_index; i++) {
-    /* TT move lookup */
-    if(tt_from_to && move_array[i].from_to == tt_from_to) {
-      /* do whatever needs to be done for the most important move 
-	 in the search... */
-      move_array[i].key = TRANSREF_BONUS;
-      /* should swap moves */
-      tt_from_to = 0;
-      continue;
-    }
-    /* give bonus to captures and XXX promotions  */
-    if(move_array[i].cap_pro) {
-      /* for now, just take the see score + some bonus (
-       * a capture is an active move after all).
-       */
-      move_array[i].key = see(turn, &move_array[i]) + 30;
-      continue;
-    }
-	  
-      /* finally, reward killers */
-    if(n && KILLERS_ON &&
-       ((move_array[i].from_to == Killer[current_ply][0].from_to) ||
-	(move_array[i].from_to == Killer[current_ply][1].from_to))) {
-      move_array[i].key = KILLER_BONUS;
-      continue;
-    }
-    /* here one could do things like centralisation etc. */
-  }
+  for(i = index; i < end_index; i++)
+    move_key[i] = (move_array[i].from_to == tt_from_to) ?
+      TRANSREF_BONUS : MVV_LVA_KEY(&move_array[i]);
+}
 
-  if(tt_from_to) { 
-    /* we should have found a killer move */
-    printf("warning: TT move not recognized"
-	   "(ply %d maxindex:%d 0x%02x-0x%02x\n",
-	   current_ply,end_index,GET_FROM(tt_from_to),GET_TO(tt_from_to));
-    log_msg("order: no tt move (ply %d 0x%02x-0x%02x\n",
-	    current_ply, GET_FROM(tt_from_to),GET_TO(tt_from_to));
-  }
+/* counter move bonus or history key for a quiet move */
+static int
+quiet_key(const move_t *m, int counter)
+{
+  if(m->from_to == counter)
+    return COUNTER_BONUS;
 
-  return 0;
+  return HISTORY_KEY(History[HISTORY_SIDE(turn)][GET_FROM(m->from_to)]
+		     [GET_TO(m->from_to)]);
 }
 
 /*
@@ -101,7 +81,7 @@ order_moves(int index, int end_index, int tt_from_to, int n)
 int
 order_root_moves(int index, int end_index, int tt_from_to, int n)
 {
-  int i;
+  int i, counter = counter_move();
   
   for (i = index; i < end_index; i++) {
 
@@ -113,7 +93,7 @@ order_root_moves(int index, int end_index, int tt_from_to, int n)
 #endif
 
     if(tt_from_to && move_array[i].from_to == tt_from_to) {
-      move_array[i].key = TRANSREF_BONUS;
+      move_key[i] = TRANSREF_BONUS;
       /* mark as used  */
       tt_from_to = 0;
       continue;
@@ -122,16 +102,21 @@ order_root_moves(int index, int end_index, int tt_from_to, int n)
     if(n && KILLERS_ON &&
        ((move_array[i].from_to == Killer[current_ply][0].from_to) ||
 	(move_array[i].from_to == Killer[current_ply][1].from_to))) {
-      move_array[i].key = KILLER_BONUS;
+      move_key[i] = KILLER_BONUS;
       continue;
     }
 
+    if(move_array[i].cap_pro)
+      move_key[i] = CAPTURE_HISTORY_KEY(&move_array[i]);
+    else
+      move_key[i] = quiet_key(&move_array[i], counter);
+
 #if 0
     if (make_move(&move_array[i], current_ply)) {
       turn = (turn == WHITE) ? BLACK : WHITE;
       current_ply++;
       /* do this with a full window, needs testing */
-      move_array[i].key = -quies(-INFINITY, INFINITY, end_index);
+      move_key[i] = -quies(-INFINITY, INFINITY, end_index);
       current_ply--;
       turn = (turn == WHITE) ? BLACK : WHITE;
       undo_move(&move_array[i], current_ply);
@@ -139,7 +124,7 @@ order_root_moves(int index, int end_index, int tt_from_to, int n)
 
 #if 0
       if (current_ply <= 1)
-	fprintf(stdout, "Score: %d\n", move_array[i].key);
+	fprintf(stdout, "Score: %d\n", move_key[i]);
 #endif
     }
     else undo_move(&move_array[i], current_ply);
@@ -159,3 +144,282 @@ order_root_moves(int index, int end_index, int tt_from_to, int n)
   return 0;
 }
 
+
+static int
+same_move(const move_t *a, const move_t *b)
+{
+  return a->from_to == b->from_to && a->cap_pro == b->cap_pro;
+}
+
+static int
+is_refutation(const struct move_picker_tag *mp, int from_to)
+{
+  int i;
+
+  for(i = 0; i < PICK_REFUTATION_MAX; i++)
+    if(mp->refutation[i] == from_to)
+      return 1;
+  return 0;
+}
+
+void
+init_picker(struct move_picker_tag *mp, int index, int tt_from_to, int n)
+{
+  mp->index = mp->end = mp->next = index;
+  mp->tt_slot = -1;
+  mp->tt_from_to = tt_from_to;
+  mp->n = n;
+  mp->refutation[0] = mp->refutation[1] = mp->refutation[2] = 0;
+
+  if(!current_ply) {
+    int i;
+
+    /* keys keep the order of the list */
+    for(i = 0; i < root_list.n; i++) {
+      move_array[index + i] = root_list.moves[i].m;
+      move_key[index + i] = root_list.n - i;
+    }
+    mp->end = index + root_list.n;
+    mp->stage = PICK_ROOT;
+    return;
+  }
+
+  if(n && KILLERS_ON) {
+    /* reset killers for NEXT ply */
+    reset_killer_use_count(current_ply+1);
+    mp->refutation[0] = Killer[current_ply][0].from_to;
+    mp->refutation[1] = Killer[current_ply][1].from_to;
+  }
+  mp->refutation[2] = counter_move();
+  if(mp->refutation[1] == mp->refutation[0])
+    mp->refutation[1] = 0;
+  if(mp->refutation[2] == mp->refutation[0] 
+     || mp->refutation[2] == mp->refutation[1])
+    mp->refutation[2] = 0;
+  mp->stage = PICK_TT;
+}
+
+/*
+ * Returns the slot of the next move to try or -1 if there are no
+ * more. Stages:
+ * 1) the hash move, if pseudo legal
+ * 2) winning and even captures (and promotions) in MVV-LVA order,
+ *    see() puts losing ones aside
+ * 3) killers and counter move, if pseudo legal and quiet
+ * 4) the remaining quiet moves by history
+ * 5) the losing captures
+ */
+int
+next_move(struct move_picker_tag *mp)
+{
+  int i, k, end;
+
+  for(;;) {
+    switch(mp->stage) {
+    case PICK_TT:
+      mp->stage = PICK_GEN_CAPTURES;
+      if(mp->tt_from_to && generate_move(turn, mp->tt_from_to, mp->end)) {
+	mp->tt_slot = mp->end++;
+	return mp->tt_slot;
+      }
+      break;
+
+    case PICK_GEN_CAPTURES:
+      mp->captures = mp->next = mp->end;
+      mp->end = mp->captures_end = generate_captures(turn, mp->end);
+      order_captures(mp->captures, mp->end, 0);
+      mp->stage = PICK_CAPTURES;
+      break;
+
+    case PICK_CAPTURES:
+      while(mp->next < mp->captures_end) {
+	move_t *m;
+
+	k = mp->next++;
+	pick(k, mp->captures_end);
+	m = &move_array[k];
+	if(mp->tt_slot >= 0 && same_move(m, &move_array[mp->tt_slot]))
+	  continue;
+	if(mvv_lva_value[GET_PIECE(*BOARD[GET_FROM(m->from_to)])] 
+	   > mvv_lva_value[GET_CAP(m->cap_pro)] && see(turn, m) < 0) {
+	  move_key[k] = LOSING_KEY;
+	  continue;
+	}
+	return k;
+      }
+      mp->stage = PICK_REFUTATIONS;
+      mp->next = 0;
+      break;
+
+    case PICK_REFUTATIONS:
+      while(mp->next < PICK_REFUTATION_MAX) {
+	int from_to = mp->refutation[mp->next++];
+
+	if(!from_to || from_to == mp->tt_from_to
+	   || !generate_move(turn, from_to, mp->end))
+	  continue;
+	/* captures had their turn */
+	if(move_array[mp->end].cap_pro) {
+	  clear_move_list(mp->end, mp->end + 1);
+	  continue;
+	}
+	return mp->end++;
+      }
+      mp->stage = PICK_GEN_QUIETS;
+      break;
+
+    case PICK_GEN_QUIETS:
+      end = generate_moves(turn, mp->end);
+      for(i = k = mp->end; i < end; i++) {
+	move_t *m = &move_array[i];
+
+	if(m->cap_pro || m->from_to == mp->tt_from_to 
+	   || is_refutation(mp, m->from_to))
+	  continue;
+	if(i != k)
+	  move_array[k] = *m;
+	move_key[k] = 
+	  HISTORY_KEY(History[HISTORY_SIDE(turn)][GET_FROM(m->from_to)]
+		      [GET_TO(m->from_to)]);
+	k++;
+      }
+      clear_move_list(k, end);
+      mp->next = mp->end;
+      mp->end = k;
+      mp->stage = PICK_QUIETS;
+      break;
+
+    case PICK_QUIETS:
+      if(mp->next < mp->end) {
+	pick(mp->next, mp->end);
+	return mp->next++;
+      }
+      mp->stage = PICK_LOSING;
+      mp->next = mp->captures;
+      break;
+
+    case PICK_LOSING:
+      while(mp->next < mp->captures_end) {
+	k = mp->next++;
+	if(move_key[k] == LOSING_KEY)
+	  return k;
+      }
+      mp->stage = PICK_DONE;
+      break;
+
+    case PICK_ROOT:
+      if(mp->next < mp->end) {
+	pick(mp->next, mp->end);
+	return mp->next++;
+      }
+      mp->stage = PICK_DONE;
+      break;
+
+    case PICK_DONE:
+      return -1;
+    }
+  }
+}
+
+/* is from_to in gameopt.searchmoves (or is that empty)? */
+static int
+is_searchmove(int from_to)
+{
+  int i;
+
+  if(!gameopt.searchmoves[0])
+    return 1;
+  for(i = 0; gameopt.searchmoves[i]; i++)
+    if(gameopt.searchmoves[i] == from_to)
+      return 1;
+  return 0;
+}
+
+/*
+ * The first search orders the root moves like order_root_moves()
+ * does, with the hash move first.
+ */
+int
+init_root_moves(void)
+{
+  int k, end, tt_from_to = 0, score, height, flag, all = 0;
+  struct root_move_tag r;
+
+  assert(current_ply == 0);
+
+  if(tt_retrieve(&move_flags[0].hash, &tt_from_to, &score, &height, 
+		 &flag) != TT_RT_FOUND)
+    tt_from_to = 0;
+
+  end = generate_moves(turn, 0);
+  order_root_moves(0, end, tt_from_to, 0);
+
+  /* without a legal move in gameopt.searchmoves, all are searched */
+  while(1) {
+    root_list.n = 0;
+    /* in key order */
+    for(k = 0; k < end; k++) {
+      pick(k, end);
+      if(make_move(&move_array[k], 0) 
+	 && (all || is_searchmove(move_array[k].from_to))) {
+	r.m = move_array[k];
+	r.nodes = 0;
+	r.score = -INFINITY;
+	root_list.moves[root_list.n++] = r;
+      }
+      undo_move(&move_array[k], 0);
+    }
+    if(root_list.n || all || !gameopt.searchmoves[0])
+      break;
+    log_msg("init_root_moves: no legal move in searchmoves, "
+	    "searching all.\n");
+    all = 1;
+  }
+
+  clear_move_list(0, end);
+  return root_list.n;
+}
+
+void
+update_root_move(int from_to, unsigned long nodes, int score)
+{
+  int i;
+
+  for(i = 0; i < root_list.n; i++)
+    if(root_list.moves[i].m.from_to == from_to) {
+      root_list.moves[i].nodes = nodes;
+      root_list.moves[i].score = score;
+      return;
+    }
+}
+
+void
+sort_root_moves(int best_from_to)
+{
+  int i, j;
+  struct root_move_tag r;
+
+  /* stable insertion sort, the list is nearly sorted anyway */
+  for(i = 1; i < root_list.n; i++) {
+    r = root_list.moves[i];
+    for(j = i; j > 0 
+	  && (r.m.from_to == best_from_to
+	      || (root_list.moves[j - 1].m.from_to != best_from_to
+		  && root_list.moves[j - 1].nodes < r.nodes));
+	j--)
+      root_list.moves[j] = root_list.moves[j - 1];
+    root_list.moves[j] = r;
+  }
+}
+
+int
+root_move_share(void)
+{
+  unsigned long total = 0;
+  int i;
+
+  for(i = 0; i < root_list.n; i++)
+    total += root_list.moves[i].nodes;
+
+  return total ? (int) (100 * root_list.moves[0].nodes / total) : 0;
+}
@@ -15,31 +15,91 @@
 #include "mstimer.h"
 #include "search.h"
 #include "quies.h"
+#include "order.h" /* order_captures */
+#include "transref.h"
+#include "smp.h"
+
+static int qsearch(int alpha,int beta,int index,int qply);
+#ifdef QUIES_CHECK
+static int quies_evasions(int alpha,int beta,int index,int qply);
+static int quies_checks(int alpha,int beta,int index,int qply);
+#endif
+
+#define SIDE_IN_CHECK() (attacks(turn^32,(turn == WHITE) ?		\
+	     (move_flags[current_ply].white_king_square) : 		\
+	     (move_flags[current_ply].black_king_square)))
 
 int
 quies(int alpha,int beta,int index)
+{
+  return qsearch(alpha,beta,index,0);
+}
+
+/* qply counts the plies since entering quiescence search */
+static int
+qsearch(int alpha,int beta,int index,int qply)
 {
   int value,k,new_index;
   int best = alpha;
-  int fix_val;
+  int fix_val, full_evals;
+  int tt_from_to, tt_score, tt_eval, tt_flag, best_from_to = 0;
 
   gamestat.quies_nps++; 
 
   /* count quies node for triggering time_check */
-  game_time.next_check++; 
+  if (IS_MAIN_THREAD) game_time.next_check++; 
+
+  if (current_ply >= MAX_SEARCH_DEPTH - 2)
+    return evaluate(alpha, beta);
+
+  /* mate distance pruning, see search() */
+  if (MATE + (int) current_ply >= beta) return beta;
+  if (-MATE - (int) current_ply - 1 <= alpha) return alpha;
+
+  /* transref table lookup, entries of any height will do */
+  gamestat.tt_quies_probes++;
+  if (tt_retrieve_quies(&move_flags[current_ply].hash, &tt_from_to,
+			&tt_score, &tt_eval, &tt_flag) == TT_RT_FOUND) {
+    gamestat.tt_quies_hits++;
+    switch(tt_flag) {
+    case LOWER_BOUND:
+      if (tt_score >= beta) return beta;
+      break;
+    case UPPER_BOUND:
+      if (tt_score <= alpha) return alpha;
+      break;
+    case EXACT_VALUE:
+      if (tt_score >= beta) return beta;
+      if (tt_score <= alpha) return alpha;
+      if (tt_from_to)
+	update_pv_hash(tt_from_to);
+      else
+	cut_pv();
+      return tt_score;
+    }
+  }
 
 #ifdef QUIES_CHECK
-  if(attacks(turn^32,(turn == WHITE) ? 
-	     (move_flags[current_ply].white_king_square) : 	
-	     (move_flags[current_ply].black_king_square)))
-    return search(alpha,beta,0,index);
+  /* no standing pat in check */
+  if(SIDE_IN_CHECK())
+    return quies_evasions(alpha,beta,index,qply);
 #endif
 
-  /* fix an evaluation */
-  fix_val = value = evaluate(alpha, beta);
+  /* fix an evaluation, unless the table knows it already */
+  if (tt_eval != TT_NO_EVAL)
+    fix_val = value = tt_eval;
+  else {
+    full_evals = gamestat.full_evals;
+    fix_val = value = evaluate(alpha, beta);
+    /* lazy evaluations depend on the window, keep full ones only */
+    if (gamestat.full_evals != full_evals)
+      tt_eval = value;
+  }
 
   if( value > alpha) {
     if (value >= beta) {
+      tt_store_quies(&move_flags[current_ply].hash, 0, value, tt_eval,
+		     LOWER_BOUND);
       return beta;
     }
       
@@ -53,41 +113,33 @@ quies(int alpha,int beta,int index)
     fix_val = (fix_val + max_pos_score < alpha) ? 
       (fix_val + max_pos_score) : fix_val;
 
-  /* generate captures and investigate promising ones */
+  /* generate captures and investigate promising ones, MVV-LVA first */
   new_index = generate_captures(turn, index);
+  order_captures(index, new_index, tt_from_to);
 
   for(k = index ; k < new_index; k++) {
-    int see_score;
+    pick(k, new_index);
     assert(move_array[k].cap_pro);
 
     /* 
        look only at winners which (in addition) 
        may be able to pull score above alpha.
-       
-       XXX could be interesting to try to prune w/o
-       calling see, e.g. based on cap_pro info.
-       also, shortcuts due to "winner anyway" might
-       be possible.
+       Delta pruning: not even winning the captured piece for free
+       would do.
     */
+    if (fix_val + capture_gain(&move_array[k]) <= alpha) continue;
 
-    see_score = see(turn,&move_array[k]);
-    if (see_score <= 0) continue;
-    
-    if (see_score + fix_val <= alpha) continue;
-    /*
-      There is no move ordering attempted. Every capture which
-      comes as far as to this point, is tried immediately.
-      The assumption is that there aren't usually many good captures
-      to order for.
-    */
+    if (!see_ge(turn, &move_array[k], MAX(1, alpha - fix_val + 1))) 
+      continue;
     
+    prefetch_child(&move_array[k]);
     if(make_move(&move_array[k],current_ply)) {
       assert(current_ply < MAX_SEARCH_DEPTH-1);
       
       turn = (turn == WHITE) ? BLACK : WHITE;
       current_ply++;
       
-      value= -quies(-beta,-best,new_index);
+      value= -qsearch(-beta,-best,new_index,qply+1);
       
       current_ply--;
       turn= (turn == WHITE) ? BLACK : WHITE;
@@ -96,12 +148,15 @@ quies(int alpha,int beta,int index)
 
       if(value > best) {
 	if(value >= beta) {
+	  tt_store_quies(&move_flags[current_ply].hash, 
+			 move_array[k].from_to, value, tt_eval, LOWER_BOUND);
 	  clear_move_list(index,new_index);
 	  return beta;
 	}
 
 	update_pv(&move_array[k]);
 	best = value;
+	best_from_to = move_array[k].from_to;
       }
     }
     else /* move illegal */
@@ -109,6 +164,128 @@ quies(int alpha,int beta,int index)
     }
   
   clear_move_list(index,new_index);
-  
+
+#ifdef QUIES_CHECK
+  if(qply < QUIES_CHECK_PLIES && QCHECKS_ON) {
+    value = quies_checks(best,beta,index,qply);
+    /* the checking move is not known here */
+    if(value > best) {
+      best = value;
+      best_from_to = 0;
+    }
+  }
+#endif
+
+  tt_store_quies(&move_flags[current_ply].hash, best_from_to, best, tt_eval,
+		 (best >= beta) ? LOWER_BOUND :
+		 ((best > alpha) ? EXACT_VALUE : UPPER_BOUND));
   return best;  
 }
+
+#ifdef QUIES_CHECK
+/* 
+ * In check all evasions are searched, captures or not. The side
+ * to move is mated if there is none.
+ */
+static int
+quies_evasions(int alpha,int beta,int index,int qply)
+{
+  int value,k,new_index,legal_found = 0;
+  int best = alpha;
+
+  gamestat.quies_evasions++;
+  new_index = generate_evasions(turn, index);
+
+  for(k = index ; k < new_index; k++) {
+    if(make_move(&move_array[k],current_ply)) {
+      legal_found++;
+      turn = (turn == WHITE) ? BLACK : WHITE;
+      current_ply++;
+      
+      value= -qsearch(-beta,-best,new_index,qply+1);
+      
+      current_ply--;
+      turn= (turn == WHITE) ? BLACK : WHITE;
+      
+      undo_move(&move_array[k],current_ply);
+
+      if(value > best) {
+	if(value >= beta) {
+	  clear_move_list(index,new_index);
+	  return beta;
+	}
+
+	update_pv(&move_array[k]);
+	best = value;
+      }
+    }
+    else /* move illegal */
+      undo_move(&move_array[k],current_ply);
+  }
+
+  clear_move_list(index,new_index);
+
+  if(!legal_found) {
+    cut_pv();
+    return MATE + current_ply;
+  }
+  return best;
+}
+
+/*
+ * Quiet moves which give check, after captures failed to cut off.
+ * The replies are searched by quies_evasions().
+ */
+static int
+quies_checks(int alpha,int beta,int index,int qply)
+{
+  int value,k,new_index,checks = 0;
+  int best = alpha;
+  square_t ksq = (turn == WHITE) ? 
+    move_flags[current_ply].black_king_square : 
+    move_flags[current_ply].white_king_square;
+
+  new_index = generate_moves(turn, index);
+
+  for(k = index ; k < new_index && checks < QUIES_MAX_CHECKS; k++) {
+    if(move_array[k].cap_pro || !maybe_check(&move_array[k], ksq))
+      continue;
+
+    if(make_move(&move_array[k],current_ply)) {
+      turn = (turn == WHITE) ? BLACK : WHITE;
+      current_ply++;
+
+      if(!SIDE_IN_CHECK()) {
+	current_ply--;
+	turn= (turn == WHITE) ? BLACK : WHITE;
+	undo_move(&move_array[k],current_ply);
+	continue;
+      }
+
+      checks++;
+      gamestat.quies_checks++;
+      value= -qsearch(-beta,-best,new_index,qply+1);
+      
+      current_ply--;
+      turn= (turn == WHITE) ? BLACK : WHITE;
+      
+      undo_move(&move_array[k],current_ply);
+
+      if(value > best) {
+	if(value >= beta) {
+	  clear_move_list(index,new_index);
+	  return beta;
+	}
+
+	update_pv(&move_array[k]);
+	best = value;
+      }
+    }
+    else /* move illegal */
+      undo_move(&move_array[k],current_ply);
+  }
+
+  clear_move_list(index,new_index);
+  return best;
+}
+#endif /* QUIES_CHECK */
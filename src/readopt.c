@@ -14,13 +14,17 @@
 #include "logger.h"
 #include "readopt.h"
 #include "helpers.h"
+#include "search.h" /* IID_REDUCTION */
 #include "book.h"
 #include "mstimer.h"
+#include "smp.h" /* MAX_THREADS */
+#include "chessio.h" /* parse_coordinate_moves */
+#include "transref.h" /* TT_BITS_TO_MB */
 
 int
 read_options(int argc, char ** argv)
 {
-  int c;
+  int c, k;
 
   while (1)
     {
@@ -42,6 +46,21 @@ read_options(int argc, char ** argv)
 	{"version", 0, 0, 'v'},
 	{"xboard", 0, 0, 'x'},
 	{"bench", 0, 0, 0},
+	{"threads", 1, 0, 0},
+	{"nopvs", 0, 0, 0},
+	{"lmr", 1, 0, 0},
+	{"nofutility", 0, 0, 0},
+	{"norazor", 0, 0, 0},
+	{"nolmp", 0, 0, 0},
+	{"iid", 1, 0, 0},
+	{"noqchecks", 0, 0, 0},
+	{"singular", 1, 0, 0},
+	{"probcut", 1, 0, 0},
+	{"ext", 1, 0, 0},
+	{"searchmoves", 1, 0, 0},
+	{"hash", 1, 0, 0},
+	{"hashfile", 1, 0, 0},
+	{"hashshm", 1, 0, 0},
 	{0, 0, 0, 0}
       };
 
@@ -78,15 +97,19 @@ read_options(int argc, char ** argv)
 	      SET_OPTION(O_FULLEVAL_BIT);
 	      break;
 	    case 7: /* transref */
+	    case 27: /* hash */
 	      gameopt.transref_size = MAX(atoi(optarg),0);
 	      if (gameopt.transref_size == 0)
 		{
 		  log_msg("No transposition table.\n");
 		  RESET_OPTION(O_TRANSREF_BIT);
+		  break;
 		}
-	      else
-		log_msg("Readopt.c: Hash table size: 2 exp(%d)\n", 
-			gameopt.transref_size);
+	      if (option_index == 7)
+		gameopt.transref_size = TT_BITS_TO_MB(gameopt.transref_size);
+	      gameopt.transref_size = MIN(gameopt.transref_size, TT_MAX_MB);
+	      log_msg("Readopt.c: Hash table size: %d MB\n", 
+		      gameopt.transref_size);
 	      break;
 	    case 8: /* nokiller */
 	      RESET_OPTION(O_KILLER_BIT);
@@ -122,6 +145,108 @@ read_options(int argc, char ** argv)
 	      log_msg("bench command\n");
 	      gameopt.test = CMD_TEST_BENCH;
 	      break;
+	    case 15: /* threads */
+	      gameopt.threads = MIN(MAX(atoi(optarg), 1), MAX_THREADS);
+	      log_msg("Search threads: %d\n", gameopt.threads);
+	      break;
+	    case 16: /* nopvs */
+	      RESET_OPTION(O_PVS_BIT);
+	      log_msg("Principal variation search off.\n");
+	      break;
+	    case 17: /* lmr */
+	      if (sscanf(optarg, "%d,%d", 
+			 &gameopt.lmr_moves, &gameopt.lmr_depth) < 1)
+		err_msg("lmr: expected <moves>[,<depth>], got %s\n", optarg);
+	      gameopt.lmr_moves = MAX(gameopt.lmr_moves, 0);
+	      gameopt.lmr_depth = MAX(gameopt.lmr_depth, 2);
+	      log_msg("Late move reductions after %d moves, depth >= %d\n",
+		      gameopt.lmr_moves, gameopt.lmr_depth);
+	      break;
+	    case 18: /* nofutility */
+	      RESET_OPTION(O_FUTILITY_BIT);
+	      log_msg("Futility pruning off.\n");
+	      break;
+	    case 19: /* norazor */
+	      RESET_OPTION(O_RAZOR_BIT);
+	      log_msg("Razoring off.\n");
+	      break;
+	    case 20: /* nolmp */
+	      RESET_OPTION(O_LMP_BIT);
+	      log_msg("Late move pruning off.\n");
+	      break;
+	    case 21: /* iid */
+	      gameopt.iid_depth = atoi(optarg);
+	      if (gameopt.iid_depth)
+		gameopt.iid_depth = MAX(gameopt.iid_depth, IID_REDUCTION + 1);
+	      log_msg("Internal iterative deepening from depth %d\n",
+		      gameopt.iid_depth);
+	      break;
+	    case 22: /* noqchecks */
+	      RESET_OPTION(O_QCHECKS_BIT);
+	      log_msg("Quiet checks in quiescence search off.\n");
+	      break;
+	    case 23: /* singular */
+	      gameopt.singular_depth = atoi(optarg);
+	      if (gameopt.singular_depth)
+		gameopt.singular_depth = MAX(gameopt.singular_depth, 
+					     SINGULAR_HEIGHT_SLACK + 1);
+	      log_msg("Singular extensions from depth %d\n",
+		      gameopt.singular_depth);
+	      break;
+	    case 24: /* probcut */
+	      if (sscanf(optarg, "%d,%d", &gameopt.probcut_margin,
+			 &gameopt.probcut_reduction) < 1)
+		err_msg("probcut: expected <margin>[,<reduction>], got %s\n",
+			optarg);
+	      gameopt.probcut_margin = MAX(gameopt.probcut_margin, 0);
+	      gameopt.probcut_reduction = MAX(gameopt.probcut_reduction, 2);
+	      log_msg("ProbCut %d above beta, depth reduced by %d\n",
+		      gameopt.probcut_margin, gameopt.probcut_reduction);
+	      break;
+	    case 25: /* ext */
+	      if (sscanf(optarg, "%d,%d,%d,%d", &gameopt.ext_check,
+			 &gameopt.ext_recapture, &gameopt.ext_pawn,
+			 &gameopt.ext_single) < 1)
+		err_msg("ext: expected <check>[,<recapture>[,<pawn>"
+			"[,<single>]]], got %s\n", optarg);
+	      if (gameopt.ext_check > EXTENSION_ONE_PLY 
+		  || gameopt.ext_recapture > EXTENSION_ONE_PLY
+		  || gameopt.ext_pawn > EXTENSION_ONE_PLY
+		  || gameopt.ext_single > EXTENSION_ONE_PLY)
+		err_msg("ext: at most %d units (one ply) each, got %s\n",
+			EXTENSION_ONE_PLY, optarg);
+	      gameopt.ext_check = 
+		MIN(MAX(gameopt.ext_check, 0), EXTENSION_ONE_PLY);
+	      gameopt.ext_recapture = 
+		MIN(MAX(gameopt.ext_recapture, 0), EXTENSION_ONE_PLY);
+	      gameopt.ext_pawn = 
+		MIN(MAX(gameopt.ext_pawn, 0), EXTENSION_ONE_PLY);
+	      gameopt.ext_single = 
+		MIN(MAX(gameopt.ext_single, 0), EXTENSION_ONE_PLY);
+	      log_msg("Extensions (1/%d ply): check %d, recapture %d, "
+		      "pawn %d, single reply %d\n", EXTENSION_ONE_PLY,
+		      gameopt.ext_check, gameopt.ext_recapture,
+		      gameopt.ext_pawn, gameopt.ext_single);
+	      break;
+	    case 26: /* searchmoves */
+	      k = parse_coordinate_moves(optarg, gameopt.searchmoves, 
+					 MAX_SEARCHMOVES);
+	      if (k < 0) {
+		err_msg("searchmoves: expected moves like e2e4,g1f3, "
+			"got %s\n", optarg);
+		k = 0;
+	      }
+	      gameopt.searchmoves[k] = 0;
+	      log_msg("Searching %d root moves only\n", k);
+	      break;
+	    case 28: /* hashfile, see main.c */
+	      tt_snapshot_file = optarg;
+	      log_msg("Hash table snapshot: %s\n", optarg);
+	      break;
+	    case 29: /* hashshm, see main.c */
+	      tt_shared_name = optarg;
+	      log_msg("Shared hash table: %s\n", optarg);
+	      break;
 	    default:
 	      err_msg("c == %c ?\n", c);
 	      break;
@@ -167,6 +292,11 @@ read_options(int argc, char ** argv)
 	       gameopt.test = CMD_TEST_MAKE;
 	       break;
 	    }
+	  else if (!strcmp(optarg,"check"))
+	    {
+	       gameopt.test = CMD_TEST_CHECK;
+	       break;
+	    }
 	  else
 	    err_msg("Ignoring optional argument for test: %s"
 		    " -- running default test.", optarg);
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h> /* memcpy */
 
 #include "chess.h"
 #include "hash.h" /* CMP64 */
@@ -9,14 +10,11 @@
 #include "repeat.h"
 #include "chessio.h"
 
-#define REPETITION_PLIES 100
-#define REP_LIST_MAX_SIZE (REPETITION_PLIES/2 + MAX_SEARCH_DEPTH/2)
+static THREAD_LOCAL position_hash_t repetition_list_w[REP_LIST_MAX_SIZE];
+static THREAD_LOCAL position_hash_t repetition_list_b[REP_LIST_MAX_SIZE];
 
-static position_hash_t repetition_list_w[REP_LIST_MAX_SIZE];
-static position_hash_t repetition_list_b[REP_LIST_MAX_SIZE];
-
-position_hash_t * repetition_head_w =  repetition_list_w;
-position_hash_t * repetition_head_b =  repetition_list_b;
+THREAD_LOCAL position_hash_t * repetition_head_w;
+THREAD_LOCAL position_hash_t * repetition_head_b;
 
 
 void 
@@ -26,6 +24,34 @@ reset_rep_heads(void)
   repetition_head_b =  repetition_list_b;
 }
 
+/*
+ * Copies the repetition lists (root part only) of the calling thread
+ * to rs or back. Helper threads of the parallel search start
+ * from the root position of the main thread this way.
+ */
+void
+rep_save(struct rep_snapshot_tag *rs)
+{
+  rs->w_entries = repetition_head_w - repetition_list_w;
+  rs->b_entries = repetition_head_b - repetition_list_b;
+
+  assert(rs->w_entries >= 0 && rs->w_entries <= REP_LIST_MAX_SIZE);
+  assert(rs->b_entries >= 0 && rs->b_entries <= REP_LIST_MAX_SIZE);
+
+  memcpy(rs->w, repetition_list_w, rs->w_entries * sizeof(position_hash_t));
+  memcpy(rs->b, repetition_list_b, rs->b_entries * sizeof(position_hash_t));
+}
+
+void
+rep_restore(const struct rep_snapshot_tag *rs)
+{
+  memcpy(repetition_list_w, rs->w, rs->w_entries * sizeof(position_hash_t));
+  memcpy(repetition_list_b, rs->b, rs->b_entries * sizeof(position_hash_t));
+
+  repetition_head_w = repetition_list_w + rs->w_entries;
+  repetition_head_b = repetition_list_b + rs->b_entries;
+}
+
 void 
 rep_show_offset(void)
 {
@@ -15,31 +15,269 @@
 #include "mstimer.h"
 #include "history.h"
 #include "transref.h"
+#include "hash.h" /* child_hash */
 #include "repeat.h"
 #include "input.h"
 #include "order.h"
 #include "analyse.h"
+#include "smp.h"
+
+/* 
+ * Null move: the depth reduction grows with the remaining depth and
+ * by one more if the static eval is well above beta. Fail highs with
+ * at least NULL_VERIFY_DEPTH plies left are verified by a reduced
+ * search without null move at this node.
+ */
+#define NULL_MIN_DEPTH 2
+#define NULL_R(n) (3 + (n) / 6)
+#define NULL_EVAL_MARGIN 200
+#define NULL_VERIFY_DEPTH 8
+
+/* 
+ * Zugzwang guard: no null move for a side with nothing but king and
+ * pawns.
+ */
+#define NULL_MATERIAL_OK()						\
+  (((turn == WHITE) ? move_flags[current_ply].w_material		\
+    : move_flags[current_ply].b_material) & 0x0000ffff)
+
+/* 
+ * Pruning near the leaves, indexed by the remaining depth (before
+ * the check extension): skip quiet moves if the static eval plus
+ * the futility margin cannot reach alpha, try quies() first if the
+ * eval is below alpha by the razor margin, and skip quiet moves after
+ * so many legal moves. 
+ */
+#define PRUNING_DEPTH 3
+static const int futility_margin[PRUNING_DEPTH + 1] = { 0, 150, 300, 500 };
+static const int razor_margin[PRUNING_DEPTH + 1] = { 0, 250, 350, 450 };
+static const int lmp_moves[PRUNING_DEPTH + 1] = { 0, 6, 10, 16 };
+/* a pruned move counts as futile if the node is, else as a late move */
+#define PRUNE_COUNT(futile) ((futile) ? gamestat.futility_prunes++	\
+			     : gamestat.lmp_prunes++)
 
-#define NULL_DEPTH_REDUCTION 2
-/* so many plies away from the leafs we do a full ordering */
-#define FULL_ORDER_DEPTH 2
+/* globals */
+static THREAD_LOCAL int last_ply_null = 0;
+/* move left out by the exclusion search of a singular extension */
+static THREAD_LOCAL int excluded_move[MAX_SEARCH_DEPTH];
+/* target square of a capture made at this ply, else NO_CAPTURE */
+#define NO_CAPTURE -1
+static THREAD_LOCAL int capture_square[MAX_SEARCH_DEPTH];
+
+static int late_move_reduction(const move_t *m, int legal_found, int n,
+			       int in_check, int tt_from_to);
+static int side_in_check(void);
+static int gives_check(void);
+static int probcut(int beta, int n, int index);
+static int etc_cutoff(int beta, int n, int index);
+static int extend(int *spent, int units);
+static int check_extension(int index);
+static int move_extension(const move_t *m, int singular);
+
+/* is the side to move in check? */
+static int
+side_in_check(void)
+{
+  return attacks(turn^32, (square_t) ((turn == WHITE) ? 
+	     (move_flags[current_ply].white_king_square) : 
+	     (move_flags[current_ply].black_king_square))) != NOT_ATTACKED;
+}
 
-/* Ordering threshold is the number of legal moves executed before 
-   re-ordering the move_array via pick() is skipped completely.
-   After having seen that many moves, take the remaining moves as they
-   come in.
-   */
-#define ORDERING_THRESHOLD 6 
+/* does the move just made by the side to move give check? */
+static int
+gives_check(void)
+{
+  return attacks(turn, (square_t) ((turn == WHITE) ? 
+	     (move_flags[current_ply + 1].black_king_square) : 
+	     (move_flags[current_ply + 1].white_king_square))) != NOT_ATTACKED;
+}
 
-/* globals */
-static int last_ply_null = 0;
+/*
+ * Fractional extensions: units are 1/EXTENSION_ONE_PLY plies, spent
+ * holds the units spent along the path so far. Returns 1 if the units
+ * carry spent over a ply boundary, else 0. Units beyond one ply are
+ * cut, so a node or move is never extended by more than a ply. Along
+ * a path at most one ply per ply searched may be spent.
+ */
+static int
+extend(int *spent, int units)
+{
+  int old = *spent;
+
+  units = MIN(units, EXTENSION_ONE_PLY);
+  if (units <= 0 
+      || old + units > EXTENSION_ONE_PLY * ((int) current_ply + 1))
+    return 0;
+  *spent = old + units;
+  return MIN(*spent / EXTENSION_ONE_PLY - old / EXTENSION_ONE_PLY, 1);
+}
+
+/* 
+ * Extension of a node in check: more if there is a single legal
+ * reply. The replies are generated behind index and removed again.
+ */
+static int
+check_extension(int index)
+{
+  int k, end, legal = 0;
+
+  if (!gameopt.ext_single)
+    return gameopt.ext_check;
+
+  end = generate_evasions(turn, index);
+  for (k = index; k < end && legal < 2; k++) {
+    if (make_move(&move_array[k], current_ply))
+      legal++;
+    undo_move(&move_array[k], current_ply);
+  }
+  clear_move_list(index, end);
+
+  return gameopt.ext_check + ((legal == 1) ? gameopt.ext_single : 0);
+}
+
+/* extension of a move before it is made */
+static int
+move_extension(const move_t *m, int singular)
+{
+  int units = 0;
+  square_t to = GET_TO(m->from_to);
+
+  if (m->from_to == singular)
+    return EXTENSION_ONE_PLY;
+
+  /* recapture on the square of the last capture */
+  if (gameopt.ext_recapture && m->cap_pro && current_ply
+      && capture_square[current_ply - 1] == to)
+    units += gameopt.ext_recapture;
+
+  if (gameopt.ext_pawn && GET_PIECE(*BOARD[GET_FROM(m->from_to)]) == PAWN
+      && GET_RANK(to) == ((turn == WHITE) ? 6 : 1))
+    units += gameopt.ext_pawn;
+
+  return units;
+}
+
+/*
+ * Enhanced transposition cutoffs: a child which is known from the
+ * table to fail low at sufficient depth refutes this node without a
+ * search. The child keys are computed without making the moves, see
+ * child_hash(). The moves are generated behind index and removed
+ * again. Returns the refuting move or 0.
+ */
+static int
+etc_cutoff(int beta, int n, int index)
+{
+  int k, end, from_to, score, height, flag, cut = 0;
+  position_hash_t h;
+
+  end = generate_moves(turn, index);
+
+  /* mate scores are corrected for the child's ply */
+  current_ply++;
+  for (k = index; k < end && !cut; k++) {
+    if (!child_hash(&h, &move_array[k], current_ply - 1))
+      continue;
+    if (tt_retrieve(&h, &from_to, &score, &height, &flag) == TT_RT_FOUND
+	&& height >= n && flag != LOWER_BOUND && -score >= beta)
+      cut = move_array[k].from_to;
+  }
+  current_ply--;
+
+  clear_move_list(index, end);
+  return cut;
+}
+
+/*
+ * ProbCut: a capture which does not lose material and beats beta by
+ * the margin with the depth reduced by gameopt.probcut_reduction
+ * plies would very likely fail high at full depth as well. quies()
+ * filters the captures first. Returns 1 if the node can be cut.
+ */
+static int
+probcut(int beta, int n, int index)
+{
+  int k, end, value, p_beta = beta + gameopt.probcut_margin;
+
+  end = generate_captures(turn, index);
+  order_captures(index, end, 0);
+
+  for (k = index; k < end; k++) {
+    pick(k, end);
+    if (!see_ge(turn, &move_array[k], 0))
+      continue;
+
+    if (make_move(&move_array[k], current_ply)) {
+      line_moves[current_ply] = move_array[k].from_to;
+      capture_square[current_ply] = GET_TO(move_array[k].from_to);
+      turn = (turn == WHITE) ? BLACK : WHITE;
+      current_ply++;
+
+      value = -quies(-p_beta, -p_beta + 1, end);
+      if (value >= p_beta)
+	value = -search(-p_beta, -p_beta + 1, 
+			n - gameopt.probcut_reduction, end);
+
+      current_ply--;
+      turn = (turn == WHITE) ? BLACK : WHITE;
+      undo_move(&move_array[k], current_ply);
+
+      if (value >= p_beta && !abort_search) {
+	clear_move_list(index, end);
+	return 1;
+      }
+    }
+    else 
+      undo_move(&move_array[k], current_ply);
+  }
+
+  clear_move_list(index, end);
+  return 0;
+}
+
+/* 
+ * Late move reductions: quiet moves coming late in the move ordering
+ * are searched with less depth first. Not for the TT move, killers,
+ * captures, promotions and check evasions; the caller checks if
+ * the move gives check. Returns the depth reduction.
+ */
+static int
+late_move_reduction(const move_t *m, int legal_found, int n, int in_check,
+		    int tt_from_to)
+{
+  int r;
+
+  if (!gameopt.lmr_moves || legal_found <= gameopt.lmr_moves
+      || n < gameopt.lmr_depth || in_check || !current_ply)
+    return 0;
+
+  if (m->cap_pro || m->from_to == tt_from_to)
+    return 0;
+
+  if (KILLERS_ON && (m->from_to == Killer[current_ply][0].from_to 
+		     || m->from_to == Killer[current_ply][1].from_to))
+    return 0;
+
+  /* very late moves lose another ply */
+  r = (legal_found > 3 * gameopt.lmr_moves) ? 2 : 1;
+
+  return MIN(r, n - 1);
+}
 
 int
 search(const int alpha, const int beta, int n, const int index)
 {
   int legal_found = 0, k, value, new_index, old_n = n;
   int tt_from_to = 0, height, flag, best_move_index;
-  int best = alpha;
+  int best = alpha, reduction;
+  int prune = 0, futile = 0, prunable, static_eval = 0;
+  square_t their_king = 0;
+  int null_parent = last_ply_null;
+  int excluded = excluded_move[current_ply], singular = 0, tt_value = 0;
+  /* not all moves searched: a move excluded or root searchmoves */
+  int partial = excluded || (!current_ply && gameopt.searchmoves[0]);
+  int in_check, ext_spent, ext, d, etc;
+  unsigned long root_nodes = 0;
+  struct move_picker_tag picker;
 
   best_move_index = index;
 
@@ -50,9 +288,10 @@ search(const int alpha, const int beta, int n, const int index)
   gamestat.search_nps++; 
 
   /* check for input or time every NPS/3 nodes depending on
-     NPS magic number in mstimer.h.
+     NPS magic number in mstimer.h. Helper threads leave this to
+     the main thread.
    */
-  if (++game_time.next_check >  NODES_BETWEEN_TIME_CHECK) {
+  if (IS_MAIN_THREAD && ++game_time.next_check > game_time.check_nodes) {
     assert(global_search_state == SEARCHING || 
 	   global_search_state == PONDERING ||
 	   global_search_state == ANALYZING);
@@ -64,10 +303,13 @@ search(const int alpha, const int beta, int n, const int index)
     case SEARCHING:
       /* may set abort_search flag */
       abort_search = time_check(); 
+      if (gameopt.maxnodes && 
+	  gamestat.search_nps + gamestat.quies_nps >= gameopt.maxnodes)
+	abort_search = 1;
       /* check for user input in search mode to implement move now 
        * command. (may set abort_search)
        */
-      if (check_input()) handle_search_input(stdin); 
+      if (!EMBEDDED_ON && check_input()) handle_search_input(stdin); 
       break;
     case PONDERING:
       if (check_input()) 
@@ -104,9 +346,21 @@ search(const int alpha, const int beta, int n, const int index)
     return REPETITION_DRAW;
   }
 
+  /*
+   * Mate distance pruning: mating at the next ply is the best and
+   * getting mated right here the worst this node can do.
+   */
+  if (current_ply) {
+    if (MATE + (int) current_ply >= beta) return beta;
+    if (-MATE - (int) current_ply - 1 <= alpha) return alpha;
+  }
+
   /* transref table lookup */
+  gamestat.tt_probes++;
   if (tt_retrieve(&move_flags[current_ply].hash, &tt_from_to,
 		  &value, &height, &flag) == TT_RT_FOUND) {
+    gamestat.tt_hits++;
+    tt_value = value;
 
 #if 0
     /* debug */
@@ -119,7 +373,9 @@ search(const int alpha, const int beta, int n, const int index)
     }
 #endif
 
-    if (height >= n) /* sufficient depth makes score valuable */ {
+    /* sufficient depth makes score valuable, but not with a move
+       excluded */
+    if (height >= n && !partial) {
       /* bounds updates are risky */
       switch(flag) {
       case LOWER_BOUND: /* fail high */
@@ -137,110 +393,282 @@ search(const int alpha, const int beta, int n, const int index)
   }
 
   /* check detection/extension - has to be done before null */
-  if (n != 0) 
-    if (attacks(turn^32,(square_t) ((turn==WHITE) ? 
-	       (move_flags[current_ply].white_king_square) : 	
-	       (move_flags[current_ply].black_king_square))) 
-       == NOT_ATTACKED)
-      n--;
+  in_check = side_in_check();
+  ext_spent = move_flags[current_ply].extension_count;
+  if (n != 0 
+      && !extend(&ext_spent, in_check ? check_extension(index) : 0))
+    n--;
 
   /* null move */
   
-  /* we are using a recursive nullmove with R (depth reduction) == 2 */
+  /* recursive null move, but never twice in a row */
   if (!last_ply_null) {
-    if (n > NULL_DEPTH_REDUCTION && (old_n > n) && NULL_ON 
-       && current_ply) {
+    if (n >= NULL_MIN_DEPTH && !in_check && NULL_ON 
+	&& current_ply && !excluded && NULL_MATERIAL_OK()
+	&& (static_eval = evaluate(beta - 1, beta + NULL_EVAL_MARGIN)) 
+	>= beta) {
+      int r = NULL_R(n) + (static_eval >= beta + NULL_EVAL_MARGIN);
+
       last_ply_null++;
+      line_moves[current_ply] = 0;
+      capture_square[current_ply] = NO_CAPTURE;
       /* just like a regular make_move */ 
       make_null_move(current_ply);
       turn = (turn == WHITE) ? BLACK : WHITE;
       current_ply++;
       
-      value = -search(-beta, -best, n - NULL_DEPTH_REDUCTION, index);
+      value = (n > r) ? -search(-beta, -beta + 1, n - r, index) 
+	: -quies(-beta, -beta + 1, index);
       
       current_ply--;
       turn = (turn == WHITE) ? BLACK : WHITE;
+      last_ply_null = 0;
       
       /* KISS : look for cutoffs only, bounds updates proved again
 	 problematic, since we might store the move best_move_index
 	 points to initially */
-      if (value >= beta)
-	return beta;
+      if (value >= beta && !abort_search) {
+	if (n < NULL_VERIFY_DEPTH) {
+	  gamestat.null_cutoffs++;
+	  return beta;
+	}
+	/* verify with null move switched off at this node */
+	gamestat.null_verifications++;
+	last_ply_null = 1;
+	value = search(beta - 1, beta, n - r + 1, index);
+	if (abort_search) return 0;
+	if (value >= beta) {
+	  gamestat.null_cutoffs++;
+	  return beta;
+	}
+      }
     }
   }
   else
     last_ply_null = 0;
-  
-  
-  new_index = generate_moves(turn, index);
 
-  gamestat.moves_generated_in_search += (new_index - index);
+  /* ProbCut in null window nodes away from mate scores, not in check */
+  if (gameopt.probcut_margin && n > gameopt.probcut_reduction 
+      && !in_check && current_ply && !excluded && beta - alpha == 1
+      && beta > MATE + MATING_THRESHOLD 
+      && beta + gameopt.probcut_margin < -MATE - MATING_THRESHOLD) {
+    if (probcut(beta, n, index)) {
+      gamestat.probcut_cutoffs++;
+      return beta;
+    }
+    if (abort_search) return 0;
+  }
+
+  /* 
+   * Pruning near the leaves: only in null window nodes, not in check
+   * and away from mate scores.
+   */
+  if (old_n <= PRUNING_DEPTH && !in_check && current_ply 
+      && beta - alpha == 1 
+      && alpha > MATE + MATING_THRESHOLD && beta < -MATE - MATING_THRESHOLD
+      && (FUTILITY_ON || RAZOR_ON || LMP_ON)) {
+    int m_max = MAX(futility_margin[old_n], razor_margin[old_n]);
+    int m_min = MIN(futility_margin[old_n], razor_margin[old_n]);
+
+    prune = 1;
+    /* 
+     * Only the comparisons with alpha - margin matter, so a lazy
+     * eval outside of that window gives the same decisions.
+     */
+    static_eval = evaluate(alpha - m_max, alpha - m_min + 1);
+    futile = FUTILITY_ON && static_eval + futility_margin[old_n] <= alpha;
+    their_king = (turn == WHITE) ? move_flags[current_ply].black_king_square
+      : move_flags[current_ply].white_king_square;
+
+    if (RAZOR_ON && static_eval + razor_margin[old_n] <= alpha) {
+      int razor_alpha = alpha - razor_margin[old_n];
+
+      value = quies(razor_alpha, razor_alpha + 1, index);
+      if (value <= razor_alpha) {
+	gamestat.razor_cutoffs++;
+	return alpha;
+      }
+    }
+  }
   
+  /*
+   * Internal iterative deepening: without a hash move a reduced
+   * search at this node has to supply one. Nodes known to fail low
+   * (upper bound in the table) store no move anyway.
+   */
+  if (gameopt.iid_depth && old_n >= gameopt.iid_depth && current_ply
+      && TRANSREF_ON && !tt_from_to && flag != UPPER_BOUND) {
+    gamestat.iid_searches++;
+    /* the null move rule applies to the reduced search as well */
+    last_ply_null = null_parent;
+    search(alpha, beta, old_n - IID_REDUCTION, index);
+    if (abort_search) return 0;
+    tt_retrieve(&move_flags[current_ply].hash, &tt_from_to,
+		&value, &height, &flag);
+  }
+
+  /*
+   * Singular extension: if all other moves fail low against a bound
+   * somewhat below the score of the hash move in a reduced search,
+   * the hash move is the only good one and gets one ply more.
+   */
+  if (gameopt.singular_depth && old_n >= gameopt.singular_depth
+      && current_ply && !excluded && tt_from_to
+      && (flag == LOWER_BOUND || flag == EXACT_VALUE)
+      && height >= old_n - SINGULAR_HEIGHT_SLACK
+      && tt_value > MATE + MATING_THRESHOLD 
+      && tt_value < -MATE - MATING_THRESHOLD) {
+    int s_beta = tt_value - SINGULAR_MARGIN(old_n);
+
+    gamestat.singular_searches++;
+    excluded_move[current_ply] = tt_from_to;
+    value = search(s_beta - 1, s_beta, old_n / 2, index);
+    excluded_move[current_ply] = 0;
+    if (abort_search) return 0;
+    if (value < s_beta) {
+      gamestat.singular_extensions++;
+      singular = tt_from_to;
+    }
+  }
+
   /* 
    * Move ordering.
-   * Every candidate move has a key associated with it, the bigger
-   * the better. High keys are awarded for being in the killer table,
-   * being a capture, being in the history table.
+   * Moves are generated in stages, see next_move(). Within a stage,
+   * the move with the highest key goes first.
    * Note that value might be altered by null move in the meantime.
    * 
    * Also try using hash move in fail-low situations (TT_MOVE not useful) 
    * if we are at the root 
    */
-
-  if(n >= FULL_ORDER_DEPTH)
-    order_root_moves(index, new_index, tt_from_to, n);
-  else {
-    if(!(flag && TT_MOVE_USEFUL) && current_ply) tt_from_to = 0;
-    order_moves(index, new_index, tt_from_to, n);
-
-  }
+  if(!(flag && TT_MOVE_USEFUL) && current_ply) tt_from_to = 0;
+  init_picker(&picker, index, tt_from_to, n);
+  etc = n >= ETC_DEPTH && TRANSREF_ON && current_ply && !excluded;
 
   assert(current_ply < MAX_SEARCH_DEPTH - 1);
     
   /* execute moves */
-  for (k = index; k < new_index; k++) {
-    gamestat.moves_looked_at_in_search++;
-    
+  for (;;) {
     /* 
-     * does the move ordering by putting move with highest key 
-     * into slot k
+     * Enhanced transposition cutoffs once the hash move (if any) has
+     * not cut off: null move and the hash move are cheaper tries.
      */
+    if (etc && PICKER_PAST_TT(&picker)) {
+      etc = 0;
+      if ((k = etc_cutoff(beta, n, picker.end))) {
+	gamestat.etc_cutoffs++;
+	tt_store(&move_flags[current_ply].hash, k, beta, old_n, LOWER_BOUND);
+	clear_move_list(index, picker.end);
+	return beta;
+      }
+    }
+    if ((k = next_move(&picker)) < 0)
+      break;
 
-    /* XXX experiment with doing this only near the leafs */
-    if ((n >= FULL_ORDER_DEPTH) || (legal_found < ORDERING_THRESHOLD))
-	pick(k,new_index);
+    /* children search behind the moves generated so far */
+    new_index = picker.end;
+    if (move_array[k].from_to == excluded)
+      continue;
+    gamestat.moves_looked_at_in_search++;
 
       /* debug */
 #if 0
       if(!current_ply) {
 	printf("Searching at root %d [%d..%d]: ", k, index, new_index);
 	fprint_move(stdout, &move_array[k]);
-	fprintf(stdout, "key = %d\n", move_array[k].key); 
+	fprintf(stdout, "key = %d\n", move_key[k]); 
       }
 #endif
 
 
+      ext = move_extension(&move_array[k], singular);
+
+      /* 
+       * Futility and late move pruning of quiet, non checking moves,
+       * decided before the move is made. Only moves which maybe_check()
+       * does not rule out are made to find out if they give check.
+       */
+      prunable = prune && legal_found && !ext && !move_array[k].cap_pro 
+	&& move_array[k].from_to != tt_from_to
+	&& (futile || (LMP_ON && legal_found >= lmp_moves[old_n]));
+      if (prunable && !maybe_check(&move_array[k], their_king)) {
+	PRUNE_COUNT(futile);
+	continue;
+      }
+
+      if (!current_ply)
+	root_nodes = gamestat.search_nps + gamestat.quies_nps;
+      prefetch_child(&move_array[k]);
       if (make_move(&move_array[k], current_ply)) {
+	int spent = ext_spent;
+
+	if (prunable && !gives_check()) {
+	  PRUNE_COUNT(futile);
+	  undo_move(&move_array[k], current_ply);
+	  continue;
+	}
+
 	legal_found++;
+	line_moves[current_ply] = move_array[k].from_to;
+	capture_square[current_ply] = move_array[k].cap_pro ?
+	  GET_TO(move_array[k].from_to) : NO_CAPTURE;
 
 	/* experimental: update analysis stats when in ply 0 */
-	if (!current_ply && IS_ANALYZING)
+	if (!current_ply && IS_ANALYZING && IS_MAIN_THREAD)
 	  update_analysis_stats(legal_found, k, old_n);
 	
 	turn = (turn == WHITE) ? BLACK : WHITE;
 	current_ply++;
-	if (n) {
-	  assert( n > 0 );
-	  value = -search(-beta, -best, n, new_index);
+	d = n + extend(&spent, ext);
+	move_flags[current_ply].extension_count = spent;
+
+	reduction = (d == n) ? 
+	  late_move_reduction(&move_array[k], legal_found, n, 
+			      in_check, tt_from_to) : 0;
+	/* no reduction for checking moves */
+	if (reduction && side_in_check())
+	  reduction = 0;
+
+	if (legal_found == 1 || (!PVS_ON && !reduction)) {
+	  if (d) {
+	    assert( d > 0 );
+	    value = -search(-beta, -best, d, new_index);
+	  }
+	  else {
+	    value = -quies(-beta, -best, new_index);
+	  }
 	}
 	else {
-	  value = -quies(-beta, -best, new_index);
+	  /* 
+	   * principal variation search: prove the move to be worse
+	   * with a null window, search again if it is not. 
+	   * Reduced moves have to fail high at reduced depth first.
+	   */
+	  value = best + 1;
+	  if (reduction) {
+	    gamestat.lmr_reductions++;
+	    value = -search(-best - 1, -best, d - reduction, new_index);
+	    if (value > best)
+	      gamestat.lmr_re_searches++;
+	  }
+	  if (value > best && !abort_search)
+	    value = d ? -search(-best - 1, -best, d, new_index) 
+	      : -quies(-best - 1, -best, new_index);
+	  if (value > best && value < beta && !abort_search) {
+	    gamestat.pvs_re_searches++;
+	    value = d ? -search(-beta, -best, d, new_index) 
+	      : -quies(-beta, -best, new_index);
+	  }
 	}
 	current_ply--;
 	turn = (turn == WHITE) ? BLACK : WHITE;
 	
 	undo_move(&move_array[k], current_ply);
 
+	if (!current_ply && !abort_search)
+	  update_root_move(move_array[k].from_to, 
+			   gamestat.search_nps + gamestat.quies_nps 
+			   - root_nodes, (value > best) ? value : -INFINITY);
+
 	if (value > best) {
 	  if (value >= beta) {
 	    if (!current_ply) {
@@ -250,10 +678,13 @@ search(const int alpha, const int beta, int n, const int index)
 	      }
 	    }
 	    if (KILLERS_ON && n) update_killers(move_array[k].from_to);
+	    update_history(&move_array[k], n);
 	    
-	    tt_store(&move_flags[current_ply].hash,
-		     move_array[k].from_to, beta, 
-		     old_n, LOWER_BOUND);
+	    if (!partial)
+	      tt_store(&move_flags[current_ply].hash,
+		       move_array[k].from_to, beta, 
+		       old_n, LOWER_BOUND);
+	    gamestat.moves_generated_in_search += (new_index - index);
 	    clear_move_list(index, new_index);
 	    return beta;
 	  } /* fail high */
@@ -263,7 +694,7 @@ search(const int alpha, const int beta, int n, const int index)
 	  
 	    if (!abort_search) {
 	      update_pv(&move_array[k]);
-	      if (!current_ply)
+	      if (!current_ply && IS_MAIN_THREAD)
 		fpost(stdout, old_n, UPDATE, value,
 		      (float) time_diff(get_time(), game_time.timestamp));
 	    }
@@ -273,8 +704,11 @@ search(const int alpha, const int beta, int n, const int index)
       else undo_move(&move_array[k], current_ply); 
   }
 
-  /* transpos store, dont store if mate */
-  if (legal_found) {
+  new_index = picker.end;
+  gamestat.moves_generated_in_search += (new_index - index);
+
+  /* transpos store, dont store if mate or with a move excluded */
+  if (legal_found && !partial) {
     if (best == alpha) {
       /* for ply 0, store the old pv move who has failed low to have it
 	 re-searched first. Other plies, we don't have a move (XXX true -?)
@@ -298,6 +732,15 @@ search(const int alpha, const int beta, int n, const int index)
 
   clear_move_list(index, new_index);
 
+  /* 
+   * The excluded hash move is the only legal one: fail low, so that a
+   * forced move always counts as singular.
+   */
+  if (!legal_found && excluded) {
+    cut_pv();
+    return alpha;
+  }
+
   /* mate / stalemate stuff */
   if (!legal_found) {
     if (attacks(turn^32,
@@ -316,39 +759,105 @@ search(const int alpha, const int beta, int n, const int index)
   return best;
 }
 
-/* XXX pointer implementation faster */
+/*
+ * Index of the first largest of n keys. With SSE4.1 or AVX2 (see
+ * -march in the Makefile) the maximum is found 4 or 8 keys at a time,
+ * then its first position by comparing for equality. The last vector
+ * is moved back to end at key[n-1], the overlap does no harm.
+ */
+#if defined (__AVX2__)
+#define KEY_LANES 8
+#elif defined (__SSE4_1__)
+#define KEY_LANES 4
+#else
+#define KEY_LANES 0
+#endif
 
-#define LOW_KEY -20000 /* smaller than a captured king */
+#if KEY_LANES
+#include <immintrin.h>
+#endif
 
-void
-pick(int start_index, int end_index)
+static int
+max_key_index(const int *key, int n)
 {
-  int i = start_index, best_index = start_index, best_key = LOW_KEY;
+  int i, best_index = 0, best_key;
+
+#if KEY_LANES == 8
+  if (n >= 8) {
+    __m256i vmax = _mm256_loadu_si256((const __m256i *) key), vbest;
+    __m128i m;
+    unsigned mask;
+
+    for (i = 8; i < n; i += 8)
+      vmax = _mm256_max_epi32(vmax, _mm256_loadu_si256((const __m256i *)
+						       (key + MIN(i, n - 8))));
+    m = _mm_max_epi32(_mm256_castsi256_si128(vmax),
+		      _mm256_extracti128_si256(vmax, 1));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+    m = _mm_max_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+    vbest = _mm256_set1_epi32(_mm_cvtsi128_si32(m));
+
+    for (i = 0; ; i = MIN(i + 8, n - 8)) {
+      mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(
+	_mm256_loadu_si256((const __m256i *) (key + i)), vbest)));
+      if (mask) break;
+    }
+    for (; !(mask & 1); mask >>= 1) i++;
+    return i;
+  }
+#elif KEY_LANES == 4
+  if (n >= 4) {
+    __m128i vmax = _mm_loadu_si128((const __m128i *) key);
+    unsigned mask;
+
+    for (i = 4; i < n; i += 4)
+      vmax = _mm_max_epi32(vmax, _mm_loadu_si128((const __m128i *)
+						 (key + MIN(i, n - 4))));
+    vmax = _mm_max_epi32(vmax, _mm_shuffle_epi32(vmax, 
+						 _MM_SHUFFLE(1, 0, 3, 2)));
+    vmax = _mm_max_epi32(vmax, _mm_shuffle_epi32(vmax,
+						 _MM_SHUFFLE(2, 3, 0, 1)));
+
+    for (i = 0; ; i = MIN(i + 4, n - 4)) {
+      mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(
+	_mm_loadu_si128((const __m128i *) (key + i)), vmax)));
+      if (mask) break;
+    }
+    for (; !(mask & 1); mask >>= 1) i++;
+    return i;
+  }
+#endif
 
-  while (i < end_index) {
-    if (move_array[i].key > best_key) {
-      best_key = move_array[i].key;
+  best_key = key[0];
+  for (i = 1; i < n; i++)
+    if (key[i] > best_key) {
+      best_key = key[i];
       best_index = i;
     }
-    i++;
-  }
+  return best_index;
+}
 
-  assert(best_key != LOW_KEY);
+/* moves the move with the largest key to start_index */
+void
+pick(int start_index, int end_index)
+{
+  int best_index;
 
-  /* 
-     here: if the best key is 0, history bonus should be added to the
-     remaining moves (best key == 0 means that all killers and captures 
-     have been tried already).
-     */
+  assert(end_index > start_index);
+
+  best_index = start_index + 
+    max_key_index(&move_key[start_index], end_index - start_index);
 
   /* swap best move with first move */
   if (best_index != start_index) {
     move_t tmp = move_array[start_index];
+    int tmp_key = move_key[start_index];
     
     move_array[start_index] = move_array[best_index];
     move_array[best_index] = tmp;
+    move_key[start_index] = move_key[best_index];
+    move_key[best_index] = tmp_key;
   }
-  
 }
 
 
@@ -0,0 +1,194 @@
+/* $Id$ */
+
+/* 
+ * Lazy smp. The helpers run their own iterative deepening on a copy
+ * of the root position and fill the shared ttable, which the main
+ * thread picks up. Only the main thread checks time and input,
+ * posts and decides on the move; helpers run until abort_search 
+ * is raised by smp_stop().
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined (UNIX)
+#include <pthread.h>
+#endif
+
+#include "chess.h"
+#include "smp.h"
+#include "search.h"
+#include "helpers.h"
+#include "history.h" /* reset_killers, reset_history */
+#include "order.h" /* root move list */
+#include "engine.h"
+#include "logger.h"
+
+THREAD_LOCAL int search_thread_id = 0;
+THREAD_LOCAL ph_entry_t ** helper_ptables = NULL;
+
+#if defined (UNIX)
+
+struct helper_tag {
+  pthread_t thread;
+  int id;
+  int running;
+  int depth;
+  const struct engine_tag * root;
+  ph_entry_t * ptable;
+  struct gamestat_tag stat; /* node counts when done */
+};
+
+/* 
+ * Every thread starting a parallel search (normally the main thread,
+ * but see gully.c) has its own set of helpers.
+ */
+static THREAD_LOCAL struct helper_tag helpers[MAX_THREADS];
+static THREAD_LOCAL int helpers_started = 0;
+
+/* helper_ptables if not set */
+static THREAD_LOCAL ph_entry_t * own_ptables[MAX_THREADS];
+
+/* the root position as seen by smp_start() */
+static THREAD_LOCAL struct engine_tag root;
+
+/* 
+ * Iterative deepening of a helper. Odd helpers start one ply deeper
+ * so that not all threads work on the same depth.
+ */
+static void *
+helper_main(void * arg)
+{
+  struct helper_tag * h = (struct helper_tag *) arg;
+  int i, score, last_score = 0;
+
+  /* shares ttable and abort_search with the starting thread */
+  engine_load(h->root);
+  search_thread_id = h->id;
+  ptable = h->ptable;
+
+  reset_killers();
+  reset_history();
+  clear_move_list(0, MAX_MOVE_ARRAY);
+  clear_pv(0);
+  memset(&gamestat, 0, sizeof(gamestat));
+  init_root_moves();
+
+  for (i = 1 + (h->id & 1); i <= h->depth && !abort_search; i++) {
+    age_history();
+    score = search(last_score - WINDOW, last_score + WINDOW, i, 0);
+    if (!abort_search && 
+	(score <= last_score - WINDOW || score >= last_score + WINDOW))
+      score = search(-INFINITY, INFINITY, i, 0);
+    if (!abort_search) {
+      last_score = score;
+      sort_root_moves(principal_variation[0][0].from_to);
+    }
+  }
+
+  h->stat = gamestat;
+  return NULL;
+}
+
+void
+smp_start(int depth)
+{
+  ph_entry_t ** tables = (helper_ptables != NULL) ? 
+    helper_ptables : own_ptables;
+  int i;
+
+  assert(IS_MAIN_THREAD);
+  assert(!helpers_started);
+
+  if (gameopt.threads <= 1) 
+    return;
+
+  engine_save(&root);
+
+  for (i = 1; i < gameopt.threads; i++) {
+    struct helper_tag * h = &helpers[i];
+    
+    h->id = i;
+    h->running = 0;
+    h->depth = depth;
+    h->root = &root;
+    if (tables[i] == NULL && (tables[i] = ph_new_table()) == NULL)
+      break;
+    h->ptable = tables[i];
+    if (pthread_create(&h->thread, NULL, helper_main, h)) {
+      err_msg("smp.c: could not start helper thread %d.\n", i);
+      break;
+    }
+    h->running = 1;
+  }
+  helpers_started = 1;
+}
+
+void
+smp_stop(void)
+{
+  int i, saved_abort = abort_search;
+
+  if (!helpers_started) 
+    return;
+  
+  abort_search = 1;
+
+  /* gameopt.threads may have changed meanwhile (cores command) */
+  for (i = 1; i < MAX_THREADS; i++) {
+    struct helper_tag * h = &helpers[i];
+
+    if (!h->running) 
+      continue;
+    pthread_join(h->thread, NULL);
+    h->running = 0;
+
+    gamestat.full_evals += h->stat.full_evals;
+    gamestat.evals += h->stat.evals;
+    gamestat.search_nps += h->stat.search_nps;
+    gamestat.quies_nps += h->stat.quies_nps;
+    gamestat.moves_generated_in_search += h->stat.moves_generated_in_search;
+    gamestat.moves_looked_at_in_search += h->stat.moves_looked_at_in_search;
+    gamestat.p_hash_hits += h->stat.p_hash_hits;
+    gamestat.p_hash_misses += h->stat.p_hash_misses;
+    gamestat.pvs_re_searches += h->stat.pvs_re_searches;
+    gamestat.lmr_reductions += h->stat.lmr_reductions;
+    gamestat.lmr_re_searches += h->stat.lmr_re_searches;
+    gamestat.futility_prunes += h->stat.futility_prunes;
+    gamestat.razor_cutoffs += h->stat.razor_cutoffs;
+    gamestat.lmp_prunes += h->stat.lmp_prunes;
+    gamestat.iid_searches += h->stat.iid_searches;
+    gamestat.quies_evasions += h->stat.quies_evasions;
+    gamestat.quies_checks += h->stat.quies_checks;
+    gamestat.singular_searches += h->stat.singular_searches;
+    gamestat.singular_extensions += h->stat.singular_extensions;
+    gamestat.etc_cutoffs += h->stat.etc_cutoffs;
+    gamestat.probcut_cutoffs += h->stat.probcut_cutoffs;
+    gamestat.null_cutoffs += h->stat.null_cutoffs;
+    gamestat.null_verifications += h->stat.null_verifications;
+    gamestat.tt_probes += h->stat.tt_probes;
+    gamestat.tt_hits += h->stat.tt_hits;
+    gamestat.tt_quies_probes += h->stat.tt_quies_probes;
+    gamestat.tt_quies_hits += h->stat.tt_quies_hits;
+  }
+
+  abort_search = saved_abort;
+  helpers_started = 0;
+}
+
+#else /* no thread support: always search with one thread */
+
+void
+smp_start(int depth)
+{
+  if (gameopt.threads > 1)
+    log_msg("smp.c: no thread support, searching with one thread.\n");
+}
+
+void
+smp_stop(void)
+{
+}
+
+#endif /* UNIX */
@@ -19,6 +19,7 @@
 #include "iterate.h"
 #include "hash.h"
 #include "transref.h" /* temporarily - tt_entry_t */
+#include "search.h" /* EXTENSION_ONE_PLY */
 
 #define SOL_ARRAY_SIZE 3000 /* only testsuites < 3000 positions will work
 			       correctly */
@@ -28,6 +29,7 @@ static int update_test_stats(struct pos_solve_stat_tag *pss, int *all_times,
 			     int * nps, int *completed,int correct);
 
 static int bench(void);
+static int self_check(void);
 static double solve_from_file(void);
 static unsigned long test_movegen(unsigned long iterate);
 static unsigned long test_make_undo(unsigned long iterate);
@@ -51,6 +53,7 @@ int
 do_test()
 {
   if(gameopt.test == CMD_TEST_BENCH) return bench();
+  if(gameopt.test == CMD_TEST_CHECK) return self_check();
   else {
     if (gameopt.testfile[0] == '\0')
       err_quit("\nYou need to specify a test file or use \"bench\"."
@@ -228,6 +231,316 @@ bench()
 }
 
 
+/*
+ * Self check (--test check, "make check"): deterministic tests of
+ * parts of the engine which print and count every failure. Node
+ * counts of the search are left out on purpose, they change with
+ * every change of the search.
+ */
+
+/* perft node counts from the literature */
+static struct perft_tag {
+  char * epd;
+  int depth;
+  unsigned long nodes;
+} perft_set[] = {
+  {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - id start;",
+   4, 197281},
+  {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+   " id kiwipete;", 3, 97862},
+  {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - id endgame;", 5, 674624},
+  {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq -"
+   " id promotions;", 4, 422333},
+  {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - id checks;",
+   3, 62379},
+  {NULL, 0, 0}
+};
+
+/* see_ge() has to agree with see() at all of these */
+static const int see_thresholds[] = {
+  -1000, -900, -600, -500, -400, -300, -201, -200, -100, -1, 
+  0, 1, 100, 200, 201, 300, 400, 500, 600, 900, 1000
+};
+
+#define CHECK_SNAPSHOT_FILE "gully-check.tt"
+#define CHECK_SNAPSHOT_DEPTH 6 /* the table is filled to, searched 2 deeper */
+
+static struct check_stats_tag {
+  unsigned long evasion_nodes; /* nodes in check */
+  unsigned long evasion_errors;
+  unsigned long see_captures;
+  unsigned long see_errors;
+  unsigned long quiet_checks; /* quiet moves giving check */
+  unsigned long maybe_check_errors;
+} check_stats;
+
+/* index of a move like m in move_array[from..to-1], -1 if none */
+static int
+find_move(const move_t * m, int from, int to)
+{
+  for (; from < to; from++)
+    if (move_array[from].from_to == m->from_to 
+	&& move_array[from].cap_pro == m->cap_pro)
+      return from;
+  return -1;
+}
+
+/* 
+ * In check: the legal moves of generate_evasions() have to be those
+ * of generate_moves(). Both lists go behind index and are removed.
+ */
+static void
+check_evasions(int index)
+{
+  int k, end = generate_moves(turn, index);
+  int evasions = generate_evasions(turn, end);
+  int errors = 0;
+
+  check_stats.evasion_nodes++;
+  for (k = index; k < evasions; k++) {
+    int legal = make_move(&move_array[k], current_ply);
+
+    undo_move(&move_array[k], current_ply);
+    if (!legal) continue;
+    if (k < end) errors += find_move(&move_array[k], end, evasions) < 0;
+    else errors += find_move(&move_array[k], index, end) < 0;
+  }
+  if (errors) {
+    check_stats.evasion_errors++;
+    fprint_board(stdout);
+    printf("check: evasions differ from the legal moves here\n");
+  }
+  clear_move_list(index, evasions);
+}
+
+/* see_ge() against see() for capture m of the side to move */
+static void
+check_see(move_t * m)
+{
+  int i, score = see(turn, m);
+
+  check_stats.see_captures++;
+  for (i = 0; i < (int) (sizeof(see_thresholds) / sizeof(int)); i++)
+    if (see_ge(turn, m, see_thresholds[i]) 
+	!= (score >= see_thresholds[i])) {
+      check_stats.see_errors++;
+      fprint_board(stdout);
+      fprint_move(stdout, m);
+      printf(" check: see %d, see_ge(%d) wrong\n", score, 
+	     see_thresholds[i]);
+      break;
+    }
+}
+
+/* 
+ * Counts the leaves depth plies down like search_fixed(), checking
+ * evasions and see_ge() on the way and that maybe_check() does not
+ * miss a check by a quiet move (see search()).
+ */
+static unsigned long
+perft(int depth, int index)
+{
+  int k, new_index;
+  unsigned long nodes = 0;
+  square_t their_king;
+
+  if (depth == 0) return 1;
+
+  if (attacks(turn ^ 32, (square_t) ((turn == WHITE) ? 
+	       move_flags[current_ply].white_king_square :
+	       move_flags[current_ply].black_king_square)) != NOT_ATTACKED)
+    check_evasions(index);
+
+  their_king = (turn == WHITE) ? move_flags[current_ply].black_king_square
+    : move_flags[current_ply].white_king_square;
+  new_index = generate_moves(turn, index);
+
+  for (k = index; k < new_index; k++) {
+    move_t * m = &move_array[k];
+    int maybe = maybe_check(m, their_king);
+
+    if (m->cap_pro && GET_CAP(m->cap_pro) && depth > 1) check_see(m);
+
+    if (make_move(m, current_ply)) {
+      if (!m->cap_pro && attacks(turn, (square_t) ((turn == WHITE) ? 
+		    move_flags[current_ply + 1].black_king_square :
+		    move_flags[current_ply + 1].white_king_square)) 
+	  != NOT_ATTACKED) {
+	check_stats.quiet_checks++;
+	if (!maybe) {
+	  check_stats.maybe_check_errors++;
+	  fprint_move(stdout, m);
+	  printf(" check: maybe_check() missed this check\n");
+	}
+      }
+      turn ^= 32;
+      current_ply++;
+      nodes += perft(depth - 1, new_index);
+      current_ply--;
+      turn ^= 32;
+    }
+    undo_move(m, current_ply);
+  }
+
+  clear_move_list(index, new_index);
+  return nodes;
+}
+
+/* checksum of the table, same entries give the same sum */
+static unsigned long
+tt_checksum(void)
+{
+  unsigned long b, sum = 0;
+  int i;
+
+  for (b = 0; b < tt_buckets; b++)
+    for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+      tt_entry_t * e = &ttable[b].entry[i];
+
+      sum = sum * 31 + e->check;
+      sum = sum * 31 + e->data;
+      sum = sum * 31 + e->data2;
+    }
+  return sum;
+}
+
+/* a search of bench position BK.12 from a new game, returns its nodes */
+static unsigned long
+check_search(int depth)
+{
+  char buf[128];
+
+  strcpy(buf, epdset[3]);
+  setup_board(buf);
+  timestamp();
+  iterate(depth, SEARCHING, NULL);
+  global_search_state = IDLING;
+  return (unsigned long) gamestat.search_nps + gamestat.quies_nps;
+}
+
+/* 
+ * Hash table snapshots (see tt_save()): a loaded or mapped snapshot
+ * has to hold the saved entries and search like the saved table, a
+ * truncated one has to be rejected with the table left alone.
+ */
+static int
+check_snapshot(void)
+{
+  unsigned long saved, nodes, buckets;
+  unsigned int generation;
+  long bytes, i;
+  int errors = 0;
+  FILE * in, * out;
+
+  if (!TRANSREF_ON || !tt_buckets) {
+    printf("check: no hash table, snapshots not checked\n");
+    return 0;
+  }
+
+  check_search(CHECK_SNAPSHOT_DEPTH);
+  saved = tt_checksum();
+  generation = tt_generation;
+  if (tt_save(CHECK_SNAPSHOT_FILE) == -1) {
+    printf("check: cannot save %s\n", CHECK_SNAPSHOT_FILE);
+    return 1;
+  }
+  /* the next search goes on from the table as it was saved */
+  tt_keep_on_setup = 1;
+  nodes = check_search(CHECK_SNAPSHOT_DEPTH + 2);
+
+  tt_clear();
+  if (tt_load(CHECK_SNAPSHOT_FILE) == -1 || tt_checksum() != saved
+      || tt_generation != generation) {
+    printf("check: loaded snapshot differs from the saved table\n");
+    errors++;
+  }
+  else if (check_search(CHECK_SNAPSHOT_DEPTH + 2) != nodes) {
+    printf("check: search from a loaded snapshot differs\n");
+    errors++;
+  }
+
+  if (tt_map(CHECK_SNAPSHOT_FILE) == -1 || tt_checksum() != saved) {
+    printf("check: mapped snapshot differs from the saved table\n");
+    errors++;
+  }
+
+  /* the snapshot but its last byte */
+  saved = tt_checksum();
+  buckets = tt_buckets;
+  if ((in = fopen(CHECK_SNAPSHOT_FILE, "rb")) == NULL)
+    err_sys("fopen %s failed", CHECK_SNAPSHOT_FILE);
+  if ((out = fopen(CHECK_SNAPSHOT_FILE ".cut", "wb")) == NULL)
+    err_sys("fopen %s failed", CHECK_SNAPSHOT_FILE ".cut");
+  if (fseek(in, 0, SEEK_END) || (bytes = ftell(in)) <= 0 
+      || fseek(in, 0, SEEK_SET))
+    err_sys("fseek %s failed", CHECK_SNAPSHOT_FILE);
+  for (i = 0; i < bytes - 1; i++)
+    putc(getc(in), out);
+  fclose(in);
+  if (fclose(out))
+    err_sys("fclose %s failed", CHECK_SNAPSHOT_FILE ".cut");
+  if (tt_load(CHECK_SNAPSHOT_FILE ".cut") != -1 || tt_buckets != buckets 
+      || tt_checksum() != saved) {
+    printf("check: truncated snapshot not rejected\n");
+    errors++;
+  }
+
+  remove(CHECK_SNAPSHOT_FILE);
+  remove(CHECK_SNAPSHOT_FILE ".cut");
+  tt_keep_on_setup = 0;
+
+  printf("snapshots: saved, loaded, mapped and a truncated one "
+	 "rejected: %s\n", errors ? "FAILED" : "ok");
+  return errors;
+}
+
+static int
+self_check(void)
+{
+  int i, errors = 0;
+
+  memset(&check_stats, 0, sizeof(check_stats));
+  game_time.time_per_move = 36000;
+
+  for (i = 0; perft_set[i].epd != NULL; i++) {
+    char buf[128];
+    unsigned long nodes;
+
+    strcpy(buf, perft_set[i].epd);
+    setup_board(buf);
+    nodes = perft(perft_set[i].depth, 0);
+    printf("perft %-10s depth %d: %8lu nodes: %s\n", gamestat.testpos_id,
+	   perft_set[i].depth, nodes, 
+	   (nodes == perft_set[i].nodes) ? "ok" : "FAILED");
+    errors += nodes != perft_set[i].nodes;
+  }
+
+  /* captures along the perft trees and of the bench positions */
+  for (i = 0; epdset[i] != NULL; i++) {
+    char buf[128];
+
+    strcpy(buf, epdset[i]);
+    setup_board(buf);
+    perft(3, 0);
+  }
+
+  printf("evasions: %lu nodes in check: %s\n", check_stats.evasion_nodes,
+	 check_stats.evasion_errors ? "FAILED" : "ok");
+  printf("see_ge: %lu captures, %d thresholds each: %s\n",
+	 check_stats.see_captures, 
+	 (int) (sizeof(see_thresholds) / sizeof(int)),
+	 check_stats.see_errors ? "FAILED" : "ok");
+  printf("maybe_check: %lu quiet checks: %s\n", check_stats.quiet_checks,
+	 check_stats.maybe_check_errors ? "FAILED" : "ok");
+  errors += (check_stats.evasion_errors != 0) + (check_stats.see_errors != 0)
+    + (check_stats.maybe_check_errors != 0);
+
+  errors += check_snapshot();
+
+  printf("%s\n", errors ? "Self check FAILED." : "Self check passed.");
+  return errors ? 1 : 0;
+}
+
 static double 
 solve_from_file(void)
 {
@@ -258,11 +571,34 @@ solve_from_file(void)
   printf("Thinking time per move: %d seconds.\n", 
 	 game_time.time_per_move/10); 
   if(TRANSREF_ON) {
-    int tts = 1 << gameopt.transref_size;
-    printf("Main hash table size: %d MBytes (%d entries).\n",
-	   ((tts / 1024) * sizeof(tt_entry_t)) / 1024, tts);
+    printf("Main hash table size: %lu MBytes (%lu entries).\n",
+	   (tt_buckets * sizeof(tt_bucket_t)) >> 20, 
+	   tt_buckets * TT_BUCKET_ENTRIES);
   } else printf("Main hash table OFF.\n");
   printf("Null moves %s.\n", NULL_ON ? "ON" : "OFF"); 
+  printf("PVS %s.\n", PVS_ON ? "ON" : "OFF"); 
+  if(gameopt.lmr_moves)
+    printf("Late move reductions after %d moves, depth >= %d.\n",
+	   gameopt.lmr_moves, gameopt.lmr_depth);
+  else printf("Late move reductions OFF.\n");
+  if(gameopt.iid_depth)
+    printf("Internal iterative deepening from depth %d.\n",
+	   gameopt.iid_depth);
+  else printf("Internal iterative deepening OFF.\n");
+  if(gameopt.singular_depth)
+    printf("Singular extensions from depth %d.\n", gameopt.singular_depth);
+  else printf("Singular extensions OFF.\n");
+  printf("Extensions (1/%d ply): check %d, recapture %d, pawn %d, "
+	 "single reply %d.\n", EXTENSION_ONE_PLY, gameopt.ext_check, 
+	 gameopt.ext_recapture, gameopt.ext_pawn, gameopt.ext_single);
+  if(gameopt.probcut_margin)
+    printf("ProbCut %d above beta, depth reduced by %d.\n",
+	   gameopt.probcut_margin, gameopt.probcut_reduction);
+  else printf("ProbCut OFF.\n");
+  printf("Futility pruning %s, razoring %s, late move pruning %s.\n",
+	 FUTILITY_ON ? "ON" : "OFF", RAZOR_ON ? "ON" : "OFF",
+	 LMP_ON ? "ON" : "OFF");
+  printf("Quiet checks in quiescence %s.\n", QCHECKS_ON ? "ON" : "OFF");
 
   time = get_time();
 
@@ -314,28 +650,8 @@ solve_from_file(void)
       global_search_state = IDLING;
       total_time = time_diff(get_time(), game_time.timestamp);
 
-      printf("evals:%d (full:%d lazy:%.2f%%), time: %.2f [%.2f Knps]\n"
-	     "Nodes in search: %.1f million, quies: %.1f million (%.2f%%)\n"
-	     "moves in search - generated: %lu million, "
-	     "looked at: %lu million (%.2f%%)\n",
-	     gamestat.evals, gamestat.full_evals,
-	     100 - (100.0 * (gamestat.full_evals / (float) gamestat.evals)),
-	     total_time,
-	     (gamestat.quies_nps + gamestat.search_nps) / 
-	     (total_time * 1000),
-	     gamestat.search_nps / 1000000.0, gamestat.quies_nps / 1000000.0,
-	     100 * (gamestat.quies_nps 
-		    / ((float) (gamestat.quies_nps + gamestat.search_nps))), 
-	     gamestat.moves_generated_in_search / 1000000,
-	     gamestat.moves_looked_at_in_search / 1000000,
-	     100.0 * (gamestat.moves_looked_at_in_search
-		      / (float) gamestat.moves_generated_in_search));
-      printf("pawn hash: hits: %u misses: %u (%.3f%%)\n",
-	     gamestat.p_hash_hits,gamestat.p_hash_misses,
-	     ((gamestat.p_hash_hits + gamestat.p_hash_misses) ?
-	      (100.0 * gamestat.p_hash_hits 
-	       / (gamestat.p_hash_hits 
-		  + gamestat.p_hash_misses)) : 0.0));
+      fprint_gamestats(stdout, total_time);
+      fprint_root_moves(stdout, 4);
 
       test_stat.nodes_total += (gamestat.quies_nps 
 				+ gamestat.search_nps) / 1000;
@@ -1,63 +1,298 @@
 /* $Id: transref.c,v 1.15 2011-03-05 20:45:08 martin Exp $ */
 
+#if defined (UNIX)
+#define _GNU_SOURCE /* MAP_ANONYMOUS, MAP_HUGETLB, MADV_HUGEPAGE, shm_open */
+#endif
+
 #include <assert.h>
 #include <stdio.h> /* printf */
 #include <stdlib.h> /* calloc */
 #include <string.h> /* memset */
 
+#if defined (UNIX)
+#include <errno.h>
+#include <fcntl.h> /* O_* for shm_open */
+#include <pthread.h>
+#include <time.h> /* nanosleep */
+#include <unistd.h> /* sysconf, ftruncate */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "logger.h"
 #include "transref.h"
 #include "hash.h" /* CMP64 */
 #include "movegen.h" /* GET_FROM for debug only */
 #include "chessio.h" /* debug */
+#include "smp.h" /* MAX_THREADS */
 
-tt_entry_t * ttable;
-ph_entry_t * ptable;
+THREAD_LOCAL tt_bucket_t * ttable;
+THREAD_LOCAL ph_entry_t * ptable;
 
-static unsigned int tt_sizemask = 0;
+THREAD_LOCAL unsigned long tt_buckets = 0;
+THREAD_LOCAL unsigned int tt_generation = 0;
 static unsigned int ph_sizemask = 0;
 
-#define TT_MAKE_INDEX(s) ((s)->part_one & tt_sizemask)
+/* 
+ * The bucket is the high part of part_one * tt_buckets, so the
+ * number of buckets need not be a power of two. Without 64 bit
+ * longs the slower modulo does the same.
+ */
+#if ULONG_MAX > 0xffffffffUL
+#define TT_MAKE_INDEX(s) (((unsigned long) (s)->part_one * tt_buckets) >> 32)
+#else
+#define TT_MAKE_INDEX(s) ((s)->part_one % tt_buckets)
+#endif
 #define PH_MAKE_INDEX(s) ((s)->part_one & ph_sizemask)
 
-#define TT_ENTER(tt,ti,sig,from_to,sc,h,f) {	\
-  tt[ti].signature.part_one = sig->part_one;	\
-  tt[ti].signature.part_two = sig->part_two;	\
-  tt[ti].ft = from_to;				\
-  tt[ti].score = sc;				\
-  tt[ti].hf = h | f; }
+#define TT_ALIGN 64 /* size of a bucket and a cache line */
+#define TT_HUGE_PAGE (2UL << 20)
+#define TT_CLEAR_CHUNK (64UL << 20) /* at least per clearing thread */
+
+#if defined (UNIX)
+/* the table of --hashshm and its segment, see tt_share() */
+static tt_bucket_t * tt_shared_table = NULL;
+static void * tt_shared_segment = NULL;
+static size_t tt_shared_bytes = 0;
+static unsigned int * tt_shared_generation = NULL;
+#endif
+
+/* scores and evals in 16 bits, TT_NO_EVAL becomes -32768 */
+#define TT_SCORE_MAX 32767
+#define TT_PACK16(v) ((unsigned) MAX(MIN((v), TT_SCORE_MAX), -TT_SCORE_MAX) \
+		      & 0xffff)
+#define TT_UNPACK16(w) ((int) (((w) & 0xffff) ^ 0x8000) - 0x8000)
+#define TT_PACKED_NO_EVAL 0x8000
+
+#define TT_GENERATION_MASK ((1 << TT_GENERATION_BITS) - 1)
+
+#define TT_FROM_TO(e) ((int) ((e).data & 0xffff))
+#define TT_SCORE(e) TT_UNPACK16((e).data >> 16)
+#define TT_EVAL(e) (((e).data2 & 0xffff) == TT_PACKED_NO_EVAL ?	\
+		    TT_NO_EVAL : TT_UNPACK16((e).data2))
+#define TT_HEIGHT(e) ((int) (((e).data2 >> 16) & 0xff))
+#define TT_FLAG(e) ((int) (((e).data2 >> 24) & 0x7) << 16)
+#define TT_USED(e) (((e).data2 >> 24) & 0x7) /* empty entries have no flag */
+#define TT_AGE(e) ((tt_generation - ((e).data2 >> 27)) & TT_GENERATION_MASK)
+
+/* 
+ * The ttable is shared by all search threads without locking. The
+ * check word is stored xor'ed with the data so that an entry torn by
+ * two threads writing at the same time does not verify when read back.
+ */
+#define TT_ENTER(e,sig,from_to,sc,ev,h,f) {				\
+  unsigned int d1_ = ((unsigned) (from_to) & 0xffff)			\
+    | (TT_PACK16(sc) << 16);						\
+  unsigned int d2_ = (((ev) == TT_NO_EVAL) ? TT_PACKED_NO_EVAL		\
+		      : TT_PACK16(ev))					\
+    | ((unsigned) (h) & 0xff) << 16 | (unsigned) (f) << 8		\
+    | tt_generation << 27;						\
+  (e).check = (sig)->part_two ^ d1_ ^ d2_;				\
+  (e).data = d1_;							\
+  (e).data2 = d2_; }
+
+#define TT_VERIFY(e,sig)						\
+  (TT_USED(e) && ((e).check ^ (e).data ^ (e).data2) == (sig)->part_two)
+
+/* 
+ * Replacement: the entry of the same position if there is one,
+ * otherwise the one worth least. Entries lose worth with depth and
+ * with the number of searches since they were written.
+ */
+#define TT_AGE_WEIGHT 8
+#define TT_WORTH(e) (TT_USED(e) ? TT_HEIGHT(e) - TT_AGE_WEIGHT * TT_AGE(e) \
+		     : -INFINITY)
+
+/*  Special treatment of "mate" scores:
+ *  search gives us a score as seen from the root of the current
+ *  search, e.g. (MATE - current_ply). This causes problems if
+ *  we reach this position through a longer or shorter path later.
+ *  Instead, we store the distance to mate from this very position
+ *  and correct it back when retrieving a position. 
+ */
+static int
+mate_to_tt(int score, int flag)
+{
+  if(flag == EXACT_VALUE) {
+    if(score > (-MATE - MATING_THRESHOLD) 
+       || (score < (MATE + MATING_THRESHOLD))) {
+      score = (score > 0) ? score + current_ply : score - current_ply;
+    }
+  }
+  return score;
+}
+
+static int
+mate_from_tt(int score, int flag)
+{
+  if(flag == EXACT_VALUE) {
+    if(score > (-MATE - MATING_THRESHOLD)) {
+      score -= current_ply;
+    }
+    else if (score < (MATE + MATING_THRESHOLD))
+      score += current_ply;
+  }
+  return score;
+}
+
+#if defined (UNIX)
+
+/* mappings are rounded to huge pages, so munmap needs the same size */
+static size_t
+tt_map_size(unsigned long buckets)
+{
+  size_t bytes = buckets * sizeof(tt_bucket_t);
+
+  return (bytes + TT_HUGE_PAGE - 1) & ~(TT_HUGE_PAGE - 1);
+}
+
+/* 
+ * Anonymous mappings are page aligned. Tables of a huge page or more
+ * try explicit huge pages first (see /proc/sys/vm/nr_hugepages), then
+ * ask for transparent huge pages.
+ */
+static tt_bucket_t *
+tt_alloc(unsigned long buckets)
+{
+  size_t bytes = tt_map_size(buckets);
+  void * p;
+
+#if defined (MAP_HUGETLB)
+  if (bytes >= TT_HUGE_PAGE) {
+    p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, 
+	     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      log_msg("transref.c: main hash table on huge pages.\n");
+      return (tt_bucket_t *) p;
+    }
+  }
+#endif
+
+  p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, 
+	   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return NULL;
+
+#if defined (MADV_HUGEPAGE)
+  if (madvise(p, bytes, MADV_HUGEPAGE))
+    log_msg("transref.c: no transparent huge pages.\n");
+#endif
+
+  return (tt_bucket_t *) p;
+}
+
+void
+tt_free_table(tt_bucket_t * table, unsigned long buckets)
+{
+  if (table == NULL)
+    return;
+  if (table == tt_shared_table) {
+    munmap(tt_shared_segment, tt_shared_bytes);
+    tt_shared_table = NULL;
+    tt_shared_generation = NULL;
+  }
+  else
+    munmap((void *) table, tt_map_size(buckets));
+}
+
+#else
+
+/* 
+ * The table is aligned to TT_ALIGN so that a bucket is one cache
+ * line. The pointer malloc() gave us is kept just before the table.
+ */
+static tt_bucket_t *
+tt_alloc(unsigned long buckets)
+{
+  char * raw, * aligned;
+
+  if ((raw = (char *) malloc(buckets * sizeof(tt_bucket_t) + TT_ALIGN)) 
+      == NULL)
+    return NULL;
+
+  aligned = raw + TT_ALIGN - ((size_t) raw & (TT_ALIGN - 1));
+  ((char **) aligned)[-1] = raw;
+  return (tt_bucket_t *) aligned;
+}
+
+void
+tt_free_table(tt_bucket_t * table, unsigned long buckets)
+{
+  if (table != NULL)
+    free(((char **) table)[-1]);
+}
+
+#endif /* UNIX */
 
 int 
-init_transref_table(int key_bits)
+init_transref_table(int mb)
 {
-  unsigned int size; 
+  unsigned long size; 
   
-  if ((key_bits > TT_MAX_BITS) || (key_bits < TT_MIN_BITS)) {
+  if ((mb > TT_MAX_MB) || (mb < TT_MIN_MB)) {
     log_msg("transref.c: init_transref_table - reverting to default size.\n");
-    key_bits = DEFAULT_TT_BITS;
+    mb = DEFAULT_TT_MB;
   }
 
-  size = 1 << key_bits;
+  size = TT_MB_BUCKETS(mb);
   
-  while ((ttable = (tt_entry_t *) malloc(size * sizeof(tt_entry_t))) == NULL) {
-    log_msg("transref.c: Shrinking requested ttable size of %d\n", size);
+  while ((ttable = tt_alloc(size)) == NULL) {
+    log_msg("transref.c: Shrinking requested ttable size of %lu\n", size);
     size = size >> 1;
-    if (size < 1 << TT_MIN_BITS ) {
-      err_msg("Error shrinking main hash table (%d).\n", size); 
+    if (size < TT_MB_BUCKETS(TT_MIN_MB)) {
+      err_msg("Error shrinking main hash table (%lu).\n", size); 
       return -1;
     }
   }
 
-  tt_sizemask = size-1;
+  tt_buckets = size;
+  tt_generation = 0;
 
-  log_msg("transref.c: ttsize %d bytes (0x%08x entries of size %d), "
-	  "sizemask %08x\n", size * sizeof(tt_entry_t), size, 
-	  sizeof(tt_entry_t), tt_sizemask);
+  log_msg("transref.c: ttsize %lu MB (%lu buckets of %d entries)\n",
+	  (size * sizeof(tt_bucket_t)) >> 20, size, TT_BUCKET_ENTRIES);
 
   return 0;
 
 }
 
+void
+tt_new_search(void)
+{
+  tt_generation = (tt_generation + 1) & TT_GENERATION_MASK;
+#if defined (UNIX)
+  /* all processes of a shared table age it together */
+  if (ttable != NULL && ttable == tt_shared_table) {
+    tt_generation = (*tt_shared_generation + 1) & TT_GENERATION_MASK;
+    *tt_shared_generation = tt_generation;
+  }
+#endif
+}
+
+/* 
+ * Slot for a position in bucket b: the entry of the same position
+ * (*same is set) or else the one of least worth.
+ */
+static int
+tt_slot(const tt_bucket_t * b, const position_hash_t * sig, int * same)
+{
+  int i, worth, slot = 0, least = INFINITY;
+
+  for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    tt_entry_t e = b->entry[i];
+
+    if (TT_VERIFY(e, sig)) {
+      *same = 1;
+      return i;
+    }
+    if ((worth = TT_WORTH(e)) < least) {
+      least = worth;
+      slot = i;
+    }
+  }
+  *same = 0;
+  return slot;
+}
+
 int 
 tt_store(const position_hash_t * sig, int from_to, int score, int h, int flag)
 {
@@ -75,57 +310,45 @@ tt_store(const position_hash_t * sig, int from_to, int score, int h, int flag)
    *     LOWER_BOUND: move produced a score >= beta (failed high).
    *
    * hash collision resolving:
-   * a) for different positions discard the old position (otherwise
-   * table gets polluted)
-   * b) if both positions full keys are equal (same position),
-   * we will replace if we searched deeper this time.
-   * Modification:
-   * replace if searched as deep as last time. This is done
-   * to fix the situation if we encounter a position,
-   * find a move alpha<score<beta. After storing the position
-   * we find a even better move, but cannot overwrite the
-   * entry since we have already inserted the position with
-   * the 2nd best move.
-   * Can this happen? Ideally the position should only be inserted
-   * once with the best move (before returning).
+   * a) a position already in the bucket is overwritten, but a fail
+   * low without a move keeps the move stored before. Keeping a deeper
+   * bound of the same search as well did not save nodes in tests.
+   * b) other positions replace the entry of least worth (TT_WORTH):
+   * empty ones first, then shallow ones of former searches.
    *
-   * Note that in case of a fail low (UPPER_BOUND) there is no stored
-   * move.
+   * Note that in case of a fail low (UPPER_BOUND) there is usually
+   * no move.
    */
 
-  int ti = TT_MAKE_INDEX(sig); /* index in transref table */
+  tt_bucket_t * b;
+  int slot, same, ret;
 
   if (!TRANSREF_ON) return TT_NO_TABLE;
 
   /* this is an important detail :( */
   if (abort_search) return TT_NO_TABLE;
 
-  assert(tt_sizemask);
+  assert(tt_buckets);
 
-  /*  Special treatment of "mate" scores:
-   *  search gives us a score as seen from the root of the current
-   *  search, e.g. (MATE - current_ply). This causes problems if
-   *  we reach this position through a longer or shorter path later.
-   *  Instead, we store the distance to mate from this very position
-   *  and correct it back when retrieving a position. 
-  */
-  if(flag == EXACT_VALUE) {
-    if(score > (-MATE - MATING_THRESHOLD) 
-       || (score < (MATE + MATING_THRESHOLD))) {
-      score = (score > 0) ? score + current_ply : score - current_ply;
-    }
-  }
-  
-  /* either other position or more valuable (deeper) score */
-  TT_ENTER(ttable, ti, sig, from_to, score, h, flag);
-  return TT_ST_REPLACED;
+  b = &ttable[TT_MAKE_INDEX(sig)];
+  slot = tt_slot(b, sig, &same);
+  ret = TT_USED(b->entry[slot]) ? TT_ST_REPLACED : TT_ST_STORED;
+
+  /* a fail low has no move, the one stored before is kept */
+  if (same && !from_to)
+    from_to = TT_FROM_TO(b->entry[slot]);
+
+  score = mate_to_tt(score, flag);
+  TT_ENTER(b->entry[slot], sig, from_to, score, TT_NO_EVAL, h, flag);
+  return ret;
 }
 
 int 
 tt_retrieve(const position_hash_t * sig, int *from_to, int *score, int *h,
 	    int *flag)
 {
-  int ti = TT_MAKE_INDEX(sig);
+  const tt_bucket_t * b;
+  int i;
 
   if (!TRANSREF_ON)  {
     *h = -1;
@@ -133,26 +356,22 @@ tt_retrieve(const position_hash_t * sig, int *from_to, int *score, int *h,
     return TT_NO_TABLE;
   }
 
-  assert(tt_sizemask);
+  assert(tt_buckets);
 
-  if (CMP64(ttable[ti].signature, *sig)) {
-    /* found */
-    
-    *h = GET_TT_HEIGHT(ttable[ti]);
-    *flag = GET_TT_FLAG(ttable[ti]);
-    *score = ttable[ti].score;
-    *from_to = ttable[ti].ft;
+  b = &ttable[TT_MAKE_INDEX(sig)];
+  for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    /* work on a copy, other threads may write to the entry meanwhile */
+    tt_entry_t e = b->entry[i];
+
+    if (TT_VERIFY(e, sig)) {
+      /* found */
+      *h = TT_HEIGHT(e);
+      *flag = TT_FLAG(e);
+      *score = mate_from_tt(TT_SCORE(e), *flag);
+      *from_to = TT_FROM_TO(e);
     
-    /* correct mate scores, see comment on top */
-    if(*flag == EXACT_VALUE) {
-      if(*score > (-MATE - MATING_THRESHOLD)) {
-	*score -= current_ply;
-      }
-      else if (*score < (MATE + MATING_THRESHOLD))
-	*score += current_ply;
+      return TT_RT_FOUND;
     }
-    
-    return TT_RT_FOUND;
   }
 
   /* not found */
@@ -163,14 +382,159 @@ tt_retrieve(const position_hash_t * sig, int *from_to, int *score, int *h,
   return TT_RT_NOT_FOUND;
 }
 
+int 
+tt_store_quies(const position_hash_t * sig, int from_to, int score, int eval,
+	       int flag)
+{
+  /* 
+   * Quiescence results are cheap to recompute, so they only go
+   * into empty slots, over other entries of height 0 or over
+   * entries of former searches. Entries of the main search are kept.
+   */
+  tt_bucket_t * b;
+  tt_entry_t * e;
+  int same, ret;
+
+  if (!TRANSREF_ON || abort_search) return TT_NO_TABLE;
+
+  assert(tt_buckets);
+
+  b = &ttable[TT_MAKE_INDEX(sig)];
+  e = &b->entry[tt_slot(b, sig, &same)];
+
+  if (TT_HEIGHT(*e) && (same || !TT_AGE(*e))) return TT_ST_MATCH;
+  ret = TT_USED(*e) ? TT_ST_REPLACED : TT_ST_STORED;
+
+  score = mate_to_tt(score, flag);
+  TT_ENTER(*e, sig, from_to, score, eval, 0, flag);
+  return ret;
+}
+
+int 
+tt_retrieve_quies(const position_hash_t * sig, int *from_to, int *score,
+		  int *eval, int *flag)
+{
+  /* any height will do for quiescence search */
+  const tt_bucket_t * b;
+  int i;
+
+  *from_to = 0;
+  *eval = TT_NO_EVAL;
+  *flag = TT_EMPTY;
+
+  if (!TRANSREF_ON) return TT_NO_TABLE;
+
+  assert(tt_buckets);
+
+  b = &ttable[TT_MAKE_INDEX(sig)];
+  for (i = 0; i < TT_BUCKET_ENTRIES; i++) {
+    tt_entry_t e = b->entry[i];
+
+    if (TT_VERIFY(e, sig)) {
+      *flag = TT_FLAG(e);
+      *score = mate_from_tt(TT_SCORE(e), *flag);
+      *from_to = TT_FROM_TO(e);
+      *eval = TT_EVAL(e);
+      return TT_RT_FOUND;
+    }
+  }
+
+  return TT_RT_NOT_FOUND;
+}
+
 int
-tt_clear(void)
+tt_hashfull(void)
+{
+  /* like UCI's hashfull: the first 1000 entries (200 buckets) */
+  unsigned long i, buckets = MIN(1000 / TT_BUCKET_ENTRIES, tt_buckets);
+  int j, used = 0;
+
+  if (!TRANSREF_ON || !tt_buckets) return 0;
+
+  for (i = 0; i < buckets; i++)
+    for (j = 0; j < TT_BUCKET_ENTRIES; j++)
+      if (TT_USED(ttable[i].entry[j]) && !TT_AGE(ttable[i].entry[j]))
+	used++;
+
+  return used * 1000 / (buckets * TT_BUCKET_ENTRIES);
+}
+
+#if defined (__GNUC__)
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p)
+#endif
+
+void
+prefetch_child(const move_t * m)
+{
+  position_hash_t h;
+
+  if (TRANSREF_ON && child_hash(&h, m, current_ply))
+    PREFETCH(&ttable[TT_MAKE_INDEX(&h)]);
+  if (child_pawn_hash(&h, m, current_ply))
+    PREFETCH(&ptable[PH_MAKE_INDEX(&h)]);
+}
+
+#if defined (UNIX)
+
+struct tt_clear_part_tag {
+  pthread_t thread;
+  char * start;
+  size_t bytes;
+  int running;
+};
+
+static void *
+tt_clear_part(void * arg)
 {
-  int size = (tt_sizemask+1) * sizeof(tt_entry_t);
+  struct tt_clear_part_tag * part = (struct tt_clear_part_tag *) arg;
 
+  memset(part->start, 0, part->bytes);
+  return NULL;
+}
+
+/* 
+ * One thread per TT_CLEAR_CHUNK, at most one per processor. A part
+ * without a thread is cleared by the calling thread.
+ */
+static void
+tt_clear_parallel(char * start, size_t bytes)
+{
+  struct tt_clear_part_tag part[MAX_THREADS];
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int i, n = (int) MIN(bytes / TT_CLEAR_CHUNK, MAX_THREADS);
+  size_t each;
+
+  n = (int) MAX(MIN(n, cpus), 1);
+  /* whole buckets per part */
+  each = (bytes / n) & ~(size_t) (TT_ALIGN - 1);
+
+  for (i = 0; i < n; i++) {
+    part[i].start = start + i * each;
+    part[i].bytes = (i == n - 1) ? bytes - i * each : each;
+    part[i].running = (i > 0 && !pthread_create(&part[i].thread, NULL,
+						tt_clear_part, &part[i]));
+  }
+
+  for (i = 0; i < n; i++)
+    if (!part[i].running)
+      tt_clear_part(&part[i]);
+  for (i = 1; i < n; i++)
+    if (part[i].running)
+      pthread_join(part[i].thread, NULL);
+}
+
+#else
+#define tt_clear_parallel(start,bytes) memset((start), 0, (bytes))
+#endif /* UNIX */
+
+int
+tt_clear(void)
+{
   if (TRANSREF_ON) {
-    assert(size >= TT_MIN_BITS * sizeof(tt_entry_t));
-    memset(ttable, 0, size);
+    assert(tt_buckets);
+    tt_clear_parallel((char *) ttable, tt_buckets * sizeof(tt_bucket_t));
   }
   return 1;
 }
@@ -205,6 +569,27 @@ init_pawn_table(int key_bits)
   return 0;
 }
 
+/* 
+ * Returns a cleared pawn table of the current size for a helper
+ * thread of the parallel search, NULL on failure. 
+ */
+ph_entry_t *
+ph_new_table(void)
+{
+  ph_entry_t * pt;
+
+  assert(ph_sizemask);
+
+  pt = (ph_entry_t *) calloc(ph_sizemask + 1, sizeof(ph_entry_t));
+  if (pt == NULL) {
+    err_msg("Error allocating pawn table for helper thread.\n");
+    return NULL;
+  }
+  /* see ph_clear */
+  pt[0].signature.part_two = -1;
+  return pt;
+}
+
 int 
 ph_store(const position_hash_t * sig, int score, int wp)
 {
@@ -261,3 +646,443 @@ ph_clear(void)
   ptable[0].signature.part_two = -1;
   return 1;
 }
+
+/**************** HASH TABLE SNAPSHOTS *************************/
+
+/* 
+ * A snapshot file is a header block followed by the buckets as they
+ * are in memory, so saving and loading are single writes and reads
+ * and the file can be mapped directly. The header tells whether the
+ * entries can be used by this engine: same entry format, same way of
+ * finding a bucket and the same hash keys.
+ */
+#define TT_FILE_MAGIC "GULLYTT"
+#define TT_FILE_VERSION 1 /* tt_entry_t and tt_bucket_t of 2.x */
+#define TT_FILE_HEADER_SIZE 4096 /* the buckets start page aligned */
+#define TT_FILE_BYTE_ORDER 0x01020304
+
+#if ULONG_MAX > 0xffffffffUL
+#define TT_KEY_SCHEME 1 /* multiply-shift index, see TT_MAKE_INDEX */
+#else
+#define TT_KEY_SCHEME 2 /* modulo index */
+#endif
+
+struct tt_file_header_tag {
+  char magic[8];
+  unsigned int version;
+  unsigned int byte_order;
+  unsigned int entry_size;
+  unsigned int bucket_size;
+  unsigned int key_scheme;
+  unsigned int keys; /* hash_keys_fingerprint() */
+  unsigned int buckets_low, buckets_high;
+  unsigned int generation;
+};
+
+/* tt_clear() from setup_position() would throw a loaded table away */
+int tt_keep_on_setup = 0;
+char * tt_snapshot_file = NULL;
+char * tt_shared_name = NULL;
+
+static void
+tt_make_header(struct tt_file_header_tag * h, unsigned long buckets,
+	       unsigned int generation)
+{
+  memset(h, 0, sizeof(*h));
+  strcpy(h->magic, TT_FILE_MAGIC);
+  h->version = TT_FILE_VERSION;
+  h->byte_order = TT_FILE_BYTE_ORDER;
+  h->entry_size = sizeof(tt_entry_t);
+  h->bucket_size = sizeof(tt_bucket_t);
+  h->key_scheme = TT_KEY_SCHEME;
+  h->keys = hash_keys_fingerprint();
+  h->buckets_low = (unsigned int) (buckets & 0xffffffffUL);
+  /* two shifts, a single one by 32 is undefined for 32 bit longs */
+  h->buckets_high = (unsigned int) ((buckets >> 16) >> 16);
+  h->generation = generation;
+}
+
+/* 
+ * Checks the header of snapshot or segment name, returns the number
+ * of buckets or 0 if the table does not fit this engine.
+ */
+static unsigned long
+tt_check_header(const struct tt_file_header_tag * h, const char * name,
+		unsigned int * generation)
+{
+  struct tt_file_header_tag mine;
+  unsigned long buckets;
+
+  if (strncmp(h->magic, TT_FILE_MAGIC, sizeof(h->magic))) {
+    err_msg("%s is no hash table snapshot.\n", name);
+    return 0;
+  }
+
+  tt_make_header(&mine, 0, 0);
+  if (h->version != mine.version || h->byte_order != mine.byte_order
+      || h->entry_size != mine.entry_size 
+      || h->bucket_size != mine.bucket_size) {
+    err_msg("%s: hash entries of version %u, this engine uses %u.\n",
+	    name, h->version, mine.version);
+    return 0;
+  }
+  if (h->key_scheme != mine.key_scheme || h->keys != mine.keys) {
+    err_msg("%s: hash keys do not match this engine.\n", name);
+    return 0;
+  }
+
+  buckets = ((unsigned long) h->buckets_high << 16 << 16) + h->buckets_low;
+  if ((buckets >> 16 >> 16) != h->buckets_high || !buckets
+      || buckets > TT_MB_BUCKETS(TT_MAX_MB)) {
+    err_msg("%s: hash table size not supported.\n", name);
+    return 0;
+  }
+
+  *generation = h->generation;
+  return buckets;
+}
+
+static unsigned long
+tt_read_header(FILE * f, const char * file, unsigned int * generation)
+{
+  struct tt_file_header_tag h;
+
+  if (fread(&h, sizeof(h), 1, f) != 1) {
+    err_msg("%s is no hash table snapshot.\n", file);
+    return 0;
+  }
+  return tt_check_header(&h, file, generation);
+}
+
+int
+tt_save(const char * file)
+{
+  struct tt_file_header_tag h;
+  char block[TT_FILE_HEADER_SIZE], tmp[FILENAME_MAX];
+  FILE * f;
+  size_t bytes = tt_buckets * sizeof(tt_bucket_t);
+
+  if (!tt_buckets) return -1;
+
+  /* 
+   * written aside and renamed: the table may be a mapping of file,
+   * truncating it would pull the pages from under the search
+   */
+  if (strlen(file) + 5 > sizeof(tmp)) {
+    err_msg("Snapshot file name too long: %s\n", file);
+    return -1;
+  }
+  sprintf(tmp, "%s.tmp", file);
+  if ((f = fopen(tmp, "wb")) == NULL) {
+    err_msg("Cannot write hash table snapshot %s.\n", tmp);
+    return -1;
+  }
+
+  tt_make_header(&h, tt_buckets, tt_generation);
+  memset(block, 0, sizeof(block));
+  memcpy(block, &h, sizeof(h));
+
+  if (fwrite(block, sizeof(block), 1, f) != 1
+      || fwrite(ttable, 1, bytes, f) != bytes) {
+    fclose(f);
+    remove(tmp);
+    err_msg("Error writing hash table snapshot %s.\n", tmp);
+    return -1;
+  }
+  if (fclose(f) || rename(tmp, file)) {
+    remove(tmp);
+    err_msg("Error writing hash table snapshot %s.\n", file);
+    return -1;
+  }
+
+  log_msg("transref.c: saved %lu MB of hash table to %s.\n", 
+	  bytes >> 20, file);
+  return 0;
+}
+
+/* does snapshot f hold all the buckets its header announces? */
+static int
+tt_file_complete(FILE * f, unsigned long buckets)
+{
+  long size;
+
+  if (fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0)
+    return 0;
+  return (unsigned long) size 
+    >= TT_FILE_HEADER_SIZE + buckets * sizeof(tt_bucket_t);
+}
+
+/* table of the snapshot's size, the old one if it cannot be had */
+static int
+tt_resize(unsigned long buckets)
+{
+  tt_bucket_t * t;
+
+  if (buckets == tt_buckets) return 0;
+
+#if defined (UNIX)
+  if (ttable != NULL && ttable == tt_shared_table) {
+    err_msg("The shared hash table is not of the snapshot's size.\n");
+    return -1;
+  }
+#endif
+
+  if ((t = tt_alloc(buckets)) == NULL) {
+    err_msg("No memory for a hash table of %lu MB.\n", 
+	    (buckets * sizeof(tt_bucket_t)) >> 20);
+    return -1;
+  }
+  tt_free_table(ttable, tt_buckets);
+  ttable = t;
+  tt_buckets = buckets;
+  return 0;
+}
+
+int
+tt_load(const char * file)
+{
+  FILE * f;
+  unsigned long buckets;
+  unsigned int generation;
+  size_t bytes;
+
+  if ((f = fopen(file, "rb")) == NULL) {
+    err_msg("Cannot read hash table snapshot %s.\n", file);
+    return -1;
+  }
+
+  if (!(buckets = tt_read_header(f, file, &generation))) {
+    fclose(f);
+    return -1;
+  }
+  if (!tt_file_complete(f, buckets)) {
+    fclose(f);
+    err_msg("%s is truncated, hash table not loaded.\n", file);
+    return -1;
+  }
+  if (fseek(f, TT_FILE_HEADER_SIZE, SEEK_SET) || tt_resize(buckets)) {
+    fclose(f);
+    return -1;
+  }
+
+  /* only a read error can get here with the table half loaded */
+  bytes = buckets * sizeof(tt_bucket_t);
+  if (fread(ttable, 1, bytes, f) != bytes) {
+    fclose(f);
+    tt_clear();
+    err_msg("Cannot read %s, hash table cleared.\n", file);
+    return -1;
+  }
+  fclose(f);
+
+  tt_generation = generation;
+  tt_keep_on_setup = 1;
+  log_msg("transref.c: loaded %lu MB of hash table from %s.\n", 
+	  bytes >> 20, file);
+  return 0;
+}
+
+#if defined (UNIX)
+
+/* 
+ * The file is mapped privately over a reserved table of the usual
+ * size (see tt_map_size), so pages are read in as the search touches
+ * them and tt_free_table() works as for any other table. The search
+ * writes to private copies, the file stays as it was.
+ */
+int
+tt_map(const char * file)
+{
+  FILE * f;
+  unsigned long buckets;
+  unsigned int generation;
+  size_t bytes;
+  long page = sysconf(_SC_PAGESIZE);
+  void * table, * p;
+
+  if ((f = fopen(file, "rb")) == NULL) {
+    err_msg("Cannot read hash table snapshot %s.\n", file);
+    return -1;
+  }
+  if (!(buckets = tt_read_header(f, file, &generation))) {
+    fclose(f);
+    return -1;
+  }
+
+  bytes = buckets * sizeof(tt_bucket_t);
+  if (page <= 0 || TT_FILE_HEADER_SIZE % page 
+      || !tt_file_complete(f, buckets)) {
+    fclose(f);
+    log_msg("transref.c: cannot map %s, reading it.\n", file);
+    return tt_load(file);
+  }
+
+  table = mmap(NULL, tt_map_size(buckets), PROT_READ | PROT_WRITE,
+	       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (table == MAP_FAILED) {
+    fclose(f);
+    err_msg("No memory for a hash table of %lu MB.\n", bytes >> 20);
+    return -1;
+  }
+  p = mmap(table, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+	   fileno(f), TT_FILE_HEADER_SIZE);
+  fclose(f);
+  if (p == MAP_FAILED) {
+    munmap(table, tt_map_size(buckets));
+    log_msg("transref.c: cannot map %s, reading it.\n", file);
+    return tt_load(file);
+  }
+
+  tt_free_table(ttable, tt_buckets);
+  ttable = (tt_bucket_t *) table;
+  tt_buckets = buckets;
+  tt_generation = generation;
+  tt_keep_on_setup = 1;
+  log_msg("transref.c: mapped %lu MB of hash table from %s.\n", 
+	  bytes >> 20, file);
+  return 0;
+}
+
+#else
+
+int
+tt_map(const char * file)
+{
+  return tt_load(file);
+}
+
+#endif /* UNIX */
+
+/**************** SHARED HASH TABLE *************************/
+
+#if defined (UNIX)
+
+#define TT_SHARE_WAIT 200 /* times 10 ms for the creator of a segment */
+
+static void
+tt_share_sleep(void)
+{
+  struct timespec ts;
+
+  ts.tv_sec = 0;
+  ts.tv_nsec = 10 * 1000 * 1000;
+  nanosleep(&ts, NULL);
+}
+
+/* 
+ * Places the main table in the POSIX shared memory segment name
+ * (/dev/shm on Linux), laid out like a snapshot file. The first
+ * process creates the segment with mb megabytes, later ones use it
+ * in whatever size it has. Entries are verified lock free (TT_VERIFY),
+ * so an entry torn by two processes does not verify. The segment
+ * outlives the processes until it is removed (shm_unlink, rm).
+ */
+int
+tt_share(const char * name, int mb)
+{
+  struct tt_file_header_tag h;
+  char shm_name[256];
+  int fd, i, created = 1;
+  unsigned long buckets = 0;
+  unsigned int generation = 0;
+  size_t bytes;
+  struct stat st;
+  char * segment;
+
+  if (strlen(name) + 2 > sizeof(shm_name)) {
+    err_msg("Shared memory name too long: %s\n", name);
+    return -1;
+  }
+  sprintf(shm_name, "%s%s", (name[0] == '/') ? "" : "/", name);
+
+  fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd == -1 && errno == EEXIST) {
+    created = 0;
+    fd = shm_open(shm_name, O_RDWR, 0);
+  }
+  if (fd == -1) {
+    err_msg("Cannot open shared memory %s.\n", shm_name);
+    return -1;
+  }
+
+  if (created) {
+    if ((mb > TT_MAX_MB) || (mb < TT_MIN_MB))
+      mb = DEFAULT_TT_MB;
+    buckets = TT_MB_BUCKETS(mb);
+    bytes = TT_FILE_HEADER_SIZE + buckets * sizeof(tt_bucket_t);
+    if (ftruncate(fd, (off_t) bytes)) {
+      close(fd);
+      shm_unlink(shm_name);
+      err_msg("No shared memory for a hash table of %d MB.\n", mb);
+      return -1;
+    }
+  }
+  else {
+    /* the creator may not have sized it yet */
+    for (i = 0; i < TT_SHARE_WAIT; i++) {
+      if (fstat(fd, &st) || st.st_size >= TT_FILE_HEADER_SIZE)
+	break;
+      tt_share_sleep();
+    }
+    if (i == TT_SHARE_WAIT || fstat(fd, &st)) {
+      close(fd);
+      err_msg("Shared memory %s is not set up.\n", shm_name);
+      return -1;
+    }
+    bytes = (size_t) st.st_size;
+  }
+
+  segment = (char *) mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+			  fd, 0);
+  close(fd);
+  if (segment == (char *) MAP_FAILED) {
+    err_msg("Cannot map shared memory %s.\n", shm_name);
+    return -1;
+  }
+
+  if (created) {
+    /* the magic goes last, others wait for it */
+    tt_make_header(&h, buckets, 0);
+    h.magic[0] = '\0';
+    memcpy(segment, &h, sizeof(h));
+    strcpy(((struct tt_file_header_tag *) segment)->magic, TT_FILE_MAGIC);
+  }
+  else {
+    for (i = 0; i < TT_SHARE_WAIT && strncmp(segment, TT_FILE_MAGIC, 
+					      sizeof(h.magic)); i++)
+      tt_share_sleep();
+    memcpy(&h, segment, sizeof(h));
+    if (!(buckets = tt_check_header(&h, shm_name, &generation))
+	|| TT_FILE_HEADER_SIZE + buckets * sizeof(tt_bucket_t) > bytes) {
+      munmap(segment, bytes);
+      return -1;
+    }
+  }
+
+  tt_free_table(ttable, tt_buckets);
+  ttable = tt_shared_table = (tt_bucket_t *) (segment + TT_FILE_HEADER_SIZE);
+  tt_buckets = buckets;
+  tt_generation = generation;
+  tt_shared_segment = segment;
+  tt_shared_bytes = bytes;
+  tt_shared_generation = 
+    &((struct tt_file_header_tag *) segment)->generation;
+  /* other processes rely on the entries */
+  tt_keep_on_setup = 1;
+
+  log_msg("transref.c: %s shared hash table %s of %lu MB.\n", 
+	  created ? "created" : "joined", shm_name, 
+	  (buckets * sizeof(tt_bucket_t)) >> 20);
+  return 0;
+}
+
+#else
+
+int
+tt_share(const char * name, int mb)
+{
+  err_msg("No shared hash tables on this system.\n");
+  return -1;
+}
+
+#endif /* UNIX */